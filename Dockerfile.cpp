@@ -0,0 +1,16 @@
+FROM gcc:latest
+
+# Precompile the C++ prelude once per supported standard. g++ picks up
+# /opt/prelude/<std>/cpp_prelude.hpp.gch whenever a check passes
+# -include /opt/prelude/<std>/cpp_prelude.hpp with a matching -std.
+COPY cpp_prelude.hpp /opt/prelude/
+RUN for std in c++20 c++17 c++14 c++11; do \
+        mkdir -p /opt/prelude/$std && \
+        cp /opt/prelude/cpp_prelude.hpp /opt/prelude/$std/ && \
+        g++ -std=$std -Wall -Wextra -x c++-header /opt/prelude/$std/cpp_prelude.hpp \
+            -o /opt/prelude/$std/cpp_prelude.hpp.gch || exit 1; \
+    done
+
+WORKDIR /workspace
+
+CMD ["bash"]
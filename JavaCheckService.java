@@ -0,0 +1,553 @@
+import java.io.BufferedInputStream;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.FileDescriptor;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.io.PrintStream;
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Method;
+import java.lang.reflect.Modifier;
+import java.net.URI;
+import java.nio.charset.StandardCharsets;
+import java.security.Permission;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.concurrent.ForkJoinPool;
+import java.util.function.Consumer;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+import javax.tools.Diagnostic;
+import javax.tools.DiagnosticCollector;
+import javax.tools.FileObject;
+import javax.tools.ForwardingJavaFileManager;
+import javax.tools.JavaCompiler;
+import javax.tools.JavaFileObject;
+import javax.tools.SimpleJavaFileObject;
+import javax.tools.StandardJavaFileManager;
+import javax.tools.ToolProvider;
+
+/**
+ * Resident Java compile service for server.js, so that a Java check costs a
+ * javac invocation in a warm JVM rather than a container and JVM start.
+ *
+ * Launch with {@code java JavaCheckService.java [runTimeoutMs [outputLimitBytes]]}.
+ * Requests arrive on stdin as a header line
+ * {@code <id> <check|run|stream> <byteLength>} followed by that many bytes
+ * of UTF-8 source. Each request is answered, in order, with one JSON line
+ * on stdout:
+ *
+ * <pre>
+ * {"id":"7","valid":false,"diagnostics":[{"kind":"error","line":3,"column":9,"message":"..."}]}
+ * {"id":"8","valid":true,"diagnostics":[],"exitStatus":0,"timedOut":false,"outputLimitExceeded":false,"stdout":"...","stderr":""}
+ * </pre>
+ *
+ * A {@code stream} request is a run whose verdict and output are also sent
+ * ahead of that line, as they become known, in replies marked partial:
+ *
+ * <pre>
+ * {"id":"9","partial":true,"valid":true,"diagnostics":[]}
+ * {"id":"9","partial":true,"stream":"stdout","data":"..."}
+ * </pre>
+ *
+ * Sources and class files never touch the disk. A run loads the classes in
+ * a fresh class loader whose parent is the platform loader, so submissions
+ * see neither this service nor each other, with stdin empty and stdout and
+ * stderr captured. When the JVM still allows a SecurityManager (up to Java
+ * 17), System.exit() in a submission ends only that run. A run that exceeds
+ * its timeout, or that leaves threads of its own running, cannot be stopped
+ * safely, so the service replies and exits, and server.js starts a fresh
+ * one. Between runs System.out and System.err discard what is written.
+ * Output is capped at outputLimitBytes for stdout and stderr together; the
+ * write that passes the cap throws an Error into the submission, which
+ * normally ends the run.
+ */
+public class JavaCheckService {
+    private static final Pattern PUBLIC_CLASS =
+        Pattern.compile("public\\s+(?:(?:final|abstract|strictfp)\\s+)*class\\s+(\\w+)");
+
+    private static final PrintStream IDLE_OUTPUT = new PrintStream(OutputStream.nullOutputStream(), true);
+
+    private static volatile boolean guardExit = false;
+
+    private final JavaCompiler compiler;
+    private final StandardJavaFileManager standardFileManager;
+    private final long runTimeoutMs;
+    private final int outputLimit;
+
+    JavaCheckService(JavaCompiler compiler, long runTimeoutMs, int outputLimit) {
+        this.compiler = compiler;
+        this.standardFileManager = compiler.getStandardFileManager(null, Locale.ROOT, StandardCharsets.UTF_8);
+        this.runTimeoutMs = runTimeoutMs;
+        this.outputLimit = outputLimit;
+    }
+
+    public static void main(String[] args) throws IOException {
+        long runTimeoutMs = args.length > 0 ? Long.parseLong(args[0]) : 10000;
+        int outputLimit = args.length > 1 ? Integer.parseInt(args[1]) : 1 << 20;
+        JavaCompiler compiler = ToolProvider.getSystemJavaCompiler();
+        if (compiler == null) {
+            System.err.println("No system Java compiler; a JDK is required");
+            System.exit(2);
+        }
+
+        // Keep the real stdout for replies; submissions get their own streams
+        // during a run and a discarding one outside it, so nothing they
+        // print can reach the reply stream
+        PrintStream replies = new PrintStream(new FileOutputStream(FileDescriptor.out), true, StandardCharsets.UTF_8);
+        DataInputStream requests = new DataInputStream(new BufferedInputStream(System.in));
+        System.setIn(new ByteArrayInputStream(new byte[0]));
+        installExitGuard();
+        System.setOut(IDLE_OUTPUT);
+        System.setErr(IDLE_OUTPUT);
+
+        JavaCheckService service = new JavaCheckService(compiler, runTimeoutMs, outputLimit);
+        service.compile("public class Warmup { public static void main(String[] args) {} }");
+
+        String header;
+        while ((header = readHeader(requests)) != null) {
+            String[] fields = header.trim().split(" ");
+            if (fields.length != 3) {
+                continue;
+            }
+            byte[] source = new byte[Integer.parseInt(fields[2])];
+            requests.readFully(source);
+            String code = new String(source, StandardCharsets.UTF_8);
+
+            String id = json(fields[0]);
+            StringBuilder reply = new StringBuilder("{\"id\":").append(id);
+            // Partial replies come from the submission's thread while the
+            // main one waits for it
+            Consumer<String> partial = !"stream".equals(fields[1]) ? null : partialFields -> {
+                synchronized (replies) {
+                    replies.println("{\"id\":" + id + ",\"partial\":true" + partialFields + "}");
+                }
+            };
+            boolean abandoned = false;
+            try {
+                abandoned = service.handle(fields[1], code, reply, partial);
+            } catch (RuntimeException | StackOverflowError e) {
+                // javac itself failed on this input
+                reply.setLength(0);
+                reply.append("{\"id\":").append(json(fields[0]))
+                    .append(",\"valid\":false,\"diagnostics\":[],\"failure\":").append(json(e.toString()));
+            }
+            synchronized (replies) {
+                replies.println(reply.append('}'));
+            }
+            if (abandoned) {
+                System.exit(3);
+            }
+        }
+    }
+
+    // Appends the reply fields for one request; true if a run was abandoned
+    // with threads of its own still running
+    boolean handle(String operation, String code, StringBuilder reply, Consumer<String> partial) {
+        Compilation compilation = compile(code);
+        StringBuilder verdict = new StringBuilder();
+        verdict.append(",\"valid\":").append(compilation.success);
+        verdict.append(",\"diagnostics\":[");
+        for (int i = 0; i < compilation.diagnostics.size(); i++) {
+            Diagnostic<? extends JavaFileObject> diagnostic = compilation.diagnostics.get(i);
+            verdict.append(i == 0 ? "" : ",")
+                .append("{\"kind\":").append(json(diagnostic.getKind().toString().toLowerCase(Locale.ROOT)))
+                .append(",\"line\":").append(Math.max(diagnostic.getLineNumber(), 0))
+                .append(",\"column\":").append(Math.max(diagnostic.getColumnNumber(), 0))
+                .append(",\"message\":").append(json(diagnostic.getMessage(Locale.ROOT)))
+                .append('}');
+        }
+        verdict.append(']');
+        reply.append(verdict);
+        boolean runs = "run".equals(operation) || "stream".equals(operation);
+        if (!compilation.success || !runs) {
+            return false;
+        }
+        if (partial != null) {
+            partial.accept(verdict.toString());
+        }
+        return run(compilation, reply, partial);
+    }
+
+    static final class Compilation {
+        boolean success;
+        String mainClassName;
+        List<Diagnostic<? extends JavaFileObject>> diagnostics;
+        Map<String, byte[]> classes;
+    }
+
+    Compilation compile(String code) {
+        Matcher publicClass = PUBLIC_CLASS.matcher(code);
+        String fileName = publicClass.find() ? publicClass.group(1) : "Main";
+
+        DiagnosticCollector<JavaFileObject> diagnostics = new DiagnosticCollector<>();
+        MemoryFileManager fileManager = new MemoryFileManager(standardFileManager);
+        JavaCompiler.CompilationTask task = compiler.getTask(
+            null, fileManager, diagnostics, Arrays.asList("-proc:none", "-encoding", "UTF-8"),
+            null, Arrays.asList(new SourceFile(fileName, code)));
+
+        Compilation compilation = new Compilation();
+        compilation.success = task.call();
+        compilation.mainClassName = fileName;
+        compilation.diagnostics = diagnostics.getDiagnostics();
+        compilation.classes = fileManager.classBytes();
+        return compilation;
+    }
+
+    boolean run(Compilation compilation, StringBuilder reply, Consumer<String> partial) {
+        MemoryClassLoader loader = new MemoryClassLoader(compilation.classes);
+        Method main;
+        try {
+            main = findMain(loader, compilation);
+        } catch (ReflectiveOperationException | LinkageError e) {
+            main = null;
+        }
+        if (main == null) {
+            reply.append(",\"exitStatus\":1,\"timedOut\":false,\"outputLimitExceeded\":false,\"stdout\":\"\",\"stderr\":")
+                .append(json("No public static void main(String[]) method found\n"));
+            return false;
+        }
+
+        RunOutput output = new RunOutput(outputLimit, partial);
+        PrintStream runOut = new PrintStream(output.out, true, StandardCharsets.UTF_8);
+        PrintStream runErr = new PrintStream(output.err, true, StandardCharsets.UTF_8);
+        int[] exitStatus = { 0 };
+
+        // Threads the submission starts join the run's group, which is how
+        // the run tells whether any of them are still going
+        ThreadGroup group = newRunGroup();
+        final Method entryPoint = main;
+        Thread runner = new Thread(group, () -> {
+            try {
+                try {
+                    entryPoint.invoke(null, (Object) new String[0]);
+                } catch (InvocationTargetException e) {
+                    Throwable cause = e.getCause();
+                    if (cause instanceof ExitRequested) {
+                        exitStatus[0] = ((ExitRequested) cause).status;
+                    } else if (cause instanceof OutputLimitExceeded) {
+                        exitStatus[0] = 1;
+                    } else {
+                        runErr.print("Exception in thread \"main\" ");
+                        cause.printStackTrace(runErr);
+                        exitStatus[0] = 1;
+                    }
+                } catch (IllegalAccessException e) {
+                    runErr.println(e);
+                    exitStatus[0] = 1;
+                }
+            } catch (OutputLimitExceeded e) {
+                // Reporting the failure went past the limit as well
+                exitStatus[0] = 1;
+            }
+        }, "main");
+        runner.setContextClassLoader(loader);
+        runner.setDaemon(true);
+
+        System.setOut(runOut);
+        System.setErr(runErr);
+        guardExit = true;
+        runner.start();
+        long deadline = System.nanoTime() + runTimeoutMs * 1_000_000L;
+        try {
+            // Until every thread of the run ends (as the JVM would wait for
+            // them), its time runs out or its output passes the limit
+            Thread live;
+            long left;
+            while ((live = liveThread(group)) != null && !output.exceeded()
+                   && (left = deadline - System.nanoTime()) > 0) {
+                live.join(Math.max(1, Math.min(50, left / 1_000_000L)));
+            }
+            if (output.exceeded()) {
+                // Let the submission unwind from the OutputLimitExceeded
+                runner.join(100);
+            }
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+        boolean exceeded = output.exceeded();
+        // A thread left in the group, or work left on the shared common
+        // pool, would go on printing into later runs and calling
+        // System.exit() unguarded; such a run can only end with the service
+        boolean abandoned = liveThread(group) != null || !ForkJoinPool.commonPool().isQuiescent();
+        guardExit = false;
+        output.close();
+        System.setOut(IDLE_OUTPUT);
+        System.setErr(IDLE_OUTPUT);
+        runOut.flush();
+        runErr.flush();
+
+        reply.append(",\"exitStatus\":").append(abandoned ? -1 : exitStatus[0])
+            .append(",\"timedOut\":").append(abandoned && !exceeded)
+            .append(",\"outputLimitExceeded\":").append(exceeded)
+            .append(",\"stdout\":").append(json(output.out.text()))
+            .append(",\"stderr\":").append(json(output.err.text()));
+        return abandoned;
+    }
+
+    // A daemon group goes away with its last thread, so finished runs
+    // leave nothing behind in the thread group tree
+    @SuppressWarnings("removal")
+    private static ThreadGroup newRunGroup() {
+        ThreadGroup group = new ThreadGroup("run");
+        group.setDaemon(true);
+        return group;
+    }
+
+    private static Thread liveThread(ThreadGroup group) {
+        Thread[] threads = new Thread[group.activeCount() + 8];
+        int count = group.enumerate(threads, true);
+        for (int i = 0; i < count; i++) {
+            if (threads[i].isAlive()) {
+                return threads[i];
+            }
+        }
+        return null;
+    }
+
+    // The public class's main, else the first class declaring one
+    private static Method findMain(ClassLoader loader, Compilation compilation) throws ReflectiveOperationException {
+        List<String> candidates = new ArrayList<>();
+        candidates.add(compilation.mainClassName);
+        candidates.addAll(compilation.classes.keySet());
+        for (String name : candidates) {
+            if (!compilation.classes.containsKey(name)) {
+                continue;
+            }
+            Class<?> type = Class.forName(name, false, loader);
+            try {
+                Method main = type.getMethod("main", String[].class);
+                if (Modifier.isStatic(main.getModifiers())) {
+                    main.setAccessible(true);
+                    return main;
+                }
+            } catch (NoSuchMethodException e) {
+                // not an entry point
+            }
+        }
+        return null;
+    }
+
+    // Turns System.exit() during a run into an exception that ends the run.
+    // SecurityManager is deprecated and refused from Java 18 on; there a
+    // submission's System.exit() ends the service instead.
+    @SuppressWarnings("removal")
+    private static void installExitGuard() {
+        try {
+            System.setSecurityManager(new SecurityManager() {
+                @Override
+                public void checkPermission(Permission permission) {
+                }
+
+                @Override
+                public void checkPermission(Permission permission, Object context) {
+                }
+
+                @Override
+                public void checkExit(int status) {
+                    if (guardExit) {
+                        throw new ExitRequested(status);
+                    }
+                }
+            });
+        } catch (UnsupportedOperationException | SecurityException e) {
+            System.err.println("SecurityManager unavailable; System.exit() in a submission will restart the service");
+        }
+    }
+
+    static final class ExitRequested extends SecurityException {
+        private static final long serialVersionUID = 1L;
+        final int status;
+
+        ExitRequested(int status) {
+            super("System.exit(" + status + ")");
+            this.status = status;
+        }
+    }
+
+    private static String readHeader(InputStream in) throws IOException {
+        ByteArrayOutputStream line = new ByteArrayOutputStream();
+        int c;
+        while ((c = in.read()) != -1 && c != '\n') {
+            line.write(c);
+        }
+        if (c == -1 && line.size() == 0) {
+            return null;
+        }
+        return new String(line.toByteArray(), StandardCharsets.UTF_8);
+    }
+
+    private static String json(String value) {
+        StringBuilder out = new StringBuilder(value.length() + 2).append('"');
+        for (int i = 0; i < value.length(); i++) {
+            char c = value.charAt(i);
+            switch (c) {
+                case '"': out.append("\\\""); break;
+                case '\\': out.append("\\\\"); break;
+                case '\n': out.append("\\n"); break;
+                case '\r': out.append("\\r"); break;
+                case '\t': out.append("\\t"); break;
+                default:
+                    if (c < 0x20) {
+                        out.append(String.format("\\u%04x", (int) c));
+                    } else {
+                        out.append(c);
+                    }
+            }
+        }
+        return out.append('"').toString();
+    }
+
+    static final class SourceFile extends SimpleJavaFileObject {
+        private final String code;
+
+        SourceFile(String className, String code) {
+            super(URI.create("string:///" + className + Kind.SOURCE.extension), Kind.SOURCE);
+            this.code = code;
+        }
+
+        @Override
+        public CharSequence getCharContent(boolean ignoreEncodingErrors) {
+            return code;
+        }
+    }
+
+    // Keeps compiled classes in memory; everything else (the platform
+    // classes) comes from the shared standard file manager, which is why
+    // close() must not be forwarded.
+    static final class MemoryFileManager extends ForwardingJavaFileManager<StandardJavaFileManager> {
+        private final Map<String, ByteArrayOutputStream> outputs = new HashMap<>();
+
+        MemoryFileManager(StandardJavaFileManager standard) {
+            super(standard);
+        }
+
+        @Override
+        public JavaFileObject getJavaFileForOutput(Location location, String className,
+                                                   JavaFileObject.Kind kind, FileObject sibling) {
+            return new SimpleJavaFileObject(URI.create("mem:///" + className.replace('.', '/') + kind.extension), kind) {
+                @Override
+                public OutputStream openOutputStream() {
+                    ByteArrayOutputStream bytes = new ByteArrayOutputStream();
+                    outputs.put(className, bytes);
+                    return bytes;
+                }
+            };
+        }
+
+        Map<String, byte[]> classBytes() {
+            Map<String, byte[]> classes = new HashMap<>();
+            for (Map.Entry<String, ByteArrayOutputStream> entry : outputs.entrySet()) {
+                classes.put(entry.getKey(), entry.getValue().toByteArray());
+            }
+            return classes;
+        }
+
+        @Override
+        public void close() {
+        }
+    }
+
+    static final class MemoryClassLoader extends ClassLoader {
+        private final Map<String, byte[]> classes;
+
+        MemoryClassLoader(Map<String, byte[]> classes) {
+            super(ClassLoader.getPlatformClassLoader());
+            this.classes = classes;
+        }
+
+        @Override
+        protected Class<?> findClass(String name) throws ClassNotFoundException {
+            byte[] bytes = classes.get(name);
+            if (bytes == null) {
+                throw new ClassNotFoundException(name);
+            }
+            return defineClass(name, bytes, 0, bytes.length);
+        }
+    }
+
+    // A run's stdout and stderr, captured up to a limit on the two together
+    // and, for a stream request, also sent on as partial replies as they are
+    // written. The write that passes the limit keeps what fits and throws
+    // OutputLimitExceeded into the submission; once the run is over
+    // (closed), writes from any threads it left behind are dropped.
+    static final class RunOutput {
+        final Capture out = new Capture("stdout");
+        final Capture err = new Capture("stderr");
+        private final int limit;
+        private final Consumer<String> partial;
+        private int written;
+        private boolean exceeded;
+        private boolean closed;
+
+        RunOutput(int limit, Consumer<String> partial) {
+            this.limit = limit;
+            this.partial = partial;
+        }
+
+        synchronized boolean exceeded() {
+            return exceeded;
+        }
+
+        synchronized void close() {
+            closed = true;
+        }
+
+        final class Capture extends OutputStream {
+            private final ByteArrayOutputStream bytes = new ByteArrayOutputStream();
+            private final String name;
+
+            Capture(String name) {
+                this.name = name;
+            }
+
+            @Override
+            public void write(int b) {
+                write(new byte[] { (byte) b }, 0, 1);
+            }
+
+            @Override
+            public void write(byte[] b, int off, int len) {
+                synchronized (RunOutput.this) {
+                    if (closed) {
+                        return;
+                    }
+                    int kept = Math.max(0, Math.min(len, limit - written));
+                    bytes.write(b, off, kept);
+                    written += kept;
+                    if (partial != null && kept > 0) {
+                        partial.accept(",\"stream\":\"" + name + "\",\"data\":"
+                            + json(new String(b, off, kept, StandardCharsets.UTF_8)));
+                    }
+                    if (kept < len) {
+                        exceeded = true;
+                        throw new OutputLimitExceeded();
+                    }
+                }
+            }
+
+            String text() {
+                synchronized (RunOutput.this) {
+                    return new String(bytes.toByteArray(), StandardCharsets.UTF_8);
+                }
+            }
+        }
+    }
+
+    // Thrown into a submission that writes past the output limit. An Error,
+    // so that the submission's own catch (Exception e) does not swallow it.
+    static final class OutputLimitExceeded extends Error {
+        private static final long serialVersionUID = 1L;
+
+        OutputLimitExceeded() {
+            super("Output limit exceeded");
+        }
+    }
+}
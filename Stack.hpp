@@ -1,35 +1,1244 @@
 #ifndef STACK_HPP
 #define STACK_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// The throwing paths are kept out of line so that the checked push/pop stay
+// small enough to inline and the message strings are never built on the
+// hot path.
+[[noreturn, gnu::cold, gnu::noinline]] inline void throwStackOverflow(const char* what) {
+    throw std::overflow_error(what);
+}
+
+[[noreturn, gnu::cold, gnu::noinline]] inline void throwStackUnderflow() {
+    throw std::underflow_error("Stack is empty");
+}
+
+// Inline element storage for Stack. The N == 0 specialization is empty, so
+// a heap-only Stack pays nothing for it.
+template <typename T, std::size_t N>
+class StackInlineBuffer {
+protected:
+    T* inlineData() {
+        return reinterpret_cast<T*>(storage);
+    }
+
+    const T* inlineData() const {
+        return reinterpret_cast<const T*>(storage);
+    }
+
+private:
+    alignas(T) unsigned char storage[sizeof(T) * N];
+};
 
 template <typename T>
-class Stack {
+class StackInlineBuffer<T, 0> {
+protected:
+    T* inlineData() {
+        return nullptr;
+    }
+
+    const T* inlineData() const {
+        return nullptr;
+    }
+};
+
+// Growable stack. Storage is obtained from Allocator on demand and grows
+// geometrically, so an empty Stack owns no memory and constructs no T.
+// Slots are raw storage: an element is constructed only by push/emplace
+// and destroyed only by pop/clear, so T need not be default-constructible.
+// With InlineCapacity > 0 the first InlineCapacity elements live inside the
+// object itself and Allocator is only used once the stack spills past them.
+template <typename T, typename Allocator = std::allocator<T>, std::size_t InlineCapacity = 0>
+class Stack : private StackInlineBuffer<T, InlineCapacity> {
 private:
-    static const int MAX_SIZE = 100;
-    T arr[MAX_SIZE];
-    int top;
+    typedef std::allocator_traits<Allocator> AllocTraits;
+
+    static const std::size_t INITIAL_CAPACITY = 8;
+
+    Allocator alloc;
+    T* arr;
+    std::size_t count;
+    std::size_t cap;
+
+    std::size_t nextCapacity() const {
+        const std::size_t maxCap = AllocTraits::max_size(alloc);
+        if (cap >= maxCap) {
+            throwStackOverflow("Stack overflow");
+        }
+        if (cap == 0) {
+            return INITIAL_CAPACITY;
+        }
+        return cap > maxCap / 2 ? maxCap : cap * 2;
+    }
+
+    void destroyAll() {
+        while (count > 0) {
+            AllocTraits::destroy(alloc, arr + --count);
+        }
+    }
+
+    bool isInline() const {
+        return arr == this->inlineData();
+    }
+
+    // Destroys the elements and returns to the (possibly empty) inline buffer.
+    void release() {
+        destroyAll();
+        if (!isInline()) {
+            AllocTraits::deallocate(alloc, arr, cap);
+            arr = this->inlineData();
+            cap = InlineCapacity;
+        }
+    }
+
+    bool canStealFrom(const Stack& other, bool propagates) const {
+        return !other.isInline() && (propagates || alloc == other.alloc);
+    }
+
+    // Takes over other's contents; *this must hold no elements and no heap
+    // buffer. A heap buffer is stolen outright, while elements sitting in
+    // other's inline buffer (or owned by an unequal allocator) are moved
+    // one by one.
+    void takeFrom(Stack& other, bool steal) {
+        if (steal) {
+            arr = other.arr;
+            count = other.count;
+            cap = other.cap;
+            other.arr = other.inlineData();
+            other.count = 0;
+            other.cap = InlineCapacity;
+            return;
+        }
+        reserve(other.count);
+        try {
+            for (; count < other.count; ++count) {
+                AllocTraits::construct(alloc, arr + count, std::move(other.arr[count]));
+            }
+        } catch (...) {
+            release();
+            throw;
+        }
+        other.destroyAll();
+    }
+
+    // Moves the live elements into newArr. If a copy throws, the part of
+    // newArr built so far is destroyed and the stack itself is untouched.
+    void relocateInto(T* newArr) {
+        std::size_t i = 0;
+        try {
+            for (; i < count; ++i) {
+                AllocTraits::construct(alloc, newArr + i, std::move_if_noexcept(arr[i]));
+            }
+        } catch (...) {
+            while (i > 0) {
+                AllocTraits::destroy(alloc, newArr + --i);
+            }
+            throw;
+        }
+    }
+
+    void adopt(T* newArr, std::size_t newCount, std::size_t newCap) {
+        release();
+        arr = newArr;
+        count = newCount;
+        cap = newCap;
+    }
+
+    void reallocate(std::size_t newCap) {
+        T* newArr = AllocTraits::allocate(alloc, newCap);
+        try {
+            relocateInto(newArr);
+        } catch (...) {
+            AllocTraits::deallocate(alloc, newArr, newCap);
+            throw;
+        }
+        adopt(newArr, count, newCap);
+    }
+
+    // The new element is built before the old buffer goes away, so pushing
+    // a reference to one of this stack's own elements is still safe.
+    template <typename... Args>
+    void growAndEmplace(Args&&... args) {
+        const std::size_t newCap = nextCapacity();
+        T* newArr = AllocTraits::allocate(alloc, newCap);
+        try {
+            AllocTraits::construct(alloc, newArr + count, std::forward<Args>(args)...);
+        } catch (...) {
+            AllocTraits::deallocate(alloc, newArr, newCap);
+            throw;
+        }
+        try {
+            relocateInto(newArr);
+        } catch (...) {
+            AllocTraits::destroy(alloc, newArr + count);
+            AllocTraits::deallocate(alloc, newArr, newCap);
+            throw;
+        }
+        adopt(newArr, count + 1, newCap);
+    }
+
+    // Makes room for n more elements with one capacity check. Growth stays
+    // geometric so that repeated bulk pushes remain amortized O(1).
+    void reserveAdditional(std::size_t n) {
+        const std::size_t maxCap = AllocTraits::max_size(alloc);
+        if (n > maxCap - count) {
+            throwStackOverflow("Stack overflow");
+        }
+        const std::size_t needed = count + n;
+        if (needed > cap) {
+            const std::size_t grown = cap == 0 ? INITIAL_CAPACITY : (cap > maxCap / 2 ? maxCap : cap * 2);
+            reallocate(needed > grown ? needed : grown);
+        }
+    }
+
+    template <typename InputIt>
+    void pushRange(InputIt first, InputIt last, std::input_iterator_tag) {
+        for (; first != last; ++first) {
+            emplace(*first);
+        }
+    }
+
+    template <typename ForwardIt>
+    void pushRange(ForwardIt first, ForwardIt last, std::forward_iterator_tag) {
+        const std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+        reserveAdditional(n);
+        if constexpr (isTrivialBlockOf<ForwardIt>()) {
+            if (n > 0) {
+                std::memcpy(arr + count, first, n * sizeof(T));
+            }
+            count += n;
+        } else {
+            const std::size_t before = count;
+            try {
+                for (; first != last; ++first) {
+                    AllocTraits::construct(alloc, arr + count, *first);
+                    ++count;
+                }
+            } catch (...) {
+                while (count > before) {
+                    AllocTraits::destroy(alloc, arr + --count);
+                }
+                throw;
+            }
+        }
+    }
+
+    // True when It is a plain pointer to T and T can be moved with memcpy.
+    template <typename It>
+    static constexpr bool isTrivialBlockOf() {
+        return std::is_trivially_copyable<T>::value && std::is_pointer<It>::value &&
+            std::is_same<typename std::remove_cv<typename std::remove_pointer<It>::type>::type, T>::value;
+    }
 
 public:
-    Stack() : top(-1) {}
+    Stack() : alloc(), arr(this->inlineData()), count(0), cap(InlineCapacity) {}
+
+    explicit Stack(const Allocator& allocator)
+        : alloc(allocator), arr(this->inlineData()), count(0), cap(InlineCapacity) {}
+
+    Stack(const Stack& other)
+        : alloc(AllocTraits::select_on_container_copy_construction(other.alloc)),
+          arr(this->inlineData()), count(0), cap(InlineCapacity) {
+        reserve(other.count);
+        for (std::size_t i = 0; i < other.count; ++i) {
+            push(other.arr[i]);
+        }
+    }
+
+    Stack(Stack&& other) noexcept(InlineCapacity == 0 || std::is_nothrow_move_constructible<T>::value)
+        : alloc(std::move(other.alloc)), arr(this->inlineData()), count(0), cap(InlineCapacity) {
+        takeFrom(other, canStealFrom(other, true));
+    }
+
+    Stack& operator=(const Stack& other) {
+        if (this != &other) {
+            Stack copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    Stack& operator=(Stack&& other) noexcept(InlineCapacity == 0 && (
+        AllocTraits::propagate_on_container_move_assignment::value ||
+        AllocTraits::is_always_equal::value)) {
+        if (this != &other) {
+            const bool propagates = AllocTraits::propagate_on_container_move_assignment::value;
+            release();
+            if (propagates) {
+                alloc = std::move(other.alloc);
+            }
+            takeFrom(other, canStealFrom(other, propagates));
+        }
+        return *this;
+    }
+
+    ~Stack() {
+        release();
+    }
+
+    void swap(Stack& other) {
+        Stack tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
 
     void push(const T& value) {
-        if (top >= MAX_SIZE - 1) {
-            throw std::overflow_error("Stack is full");
+        emplace(value);
+    }
+
+    void push(T&& value) {
+        emplace(std::move(value));
+    }
+
+    // Constructs the new top element in place from args.
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        if (count == cap) {
+            growAndEmplace(std::forward<Args>(args)...);
+            return;
         }
-        arr[++top] = value;
+        AllocTraits::construct(alloc, arr + count, std::forward<Args>(args)...);
+        ++count;
     }
 
+    // Moves the top element out and destroys its slot.
     T pop() {
         if (isEmpty()) {
-            throw std::underflow_error("Stack is empty");
+            throwStackUnderflow();
+        }
+        return popUnchecked();
+    }
+
+    // Like pop(), but reports an empty stack by returning false instead of
+    // throwing. out is left untouched in that case.
+    bool tryPop(T& out) {
+        if (isEmpty()) {
+            return false;
+        }
+        out = std::move(arr[count - 1]);
+        AllocTraits::destroy(alloc, arr + --count);
+        return true;
+    }
+
+    std::optional<T> tryPop() {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+        return std::optional<T>(popUnchecked());
+    }
+
+    // Fails only when the stack cannot grow any further. Allocation failure
+    // still surfaces as std::bad_alloc, as it does for every container.
+    bool tryPush(const T& value) {
+        if (count == cap && cap >= AllocTraits::max_size(alloc)) {
+            return false;
+        }
+        emplace(value);
+        return true;
+    }
+
+    bool tryPush(T&& value) {
+        if (count == cap && cap >= AllocTraits::max_size(alloc)) {
+            return false;
+        }
+        emplace(std::move(value));
+        return true;
+    }
+
+    // For callers that have already checked: pushUnchecked requires
+    // size() < capacity() (e.g. after reserve()), popUnchecked requires a
+    // non-empty stack. Neither branches outside of debug builds.
+    void pushUnchecked(const T& value) {
+        assert(count < cap);
+        AllocTraits::construct(alloc, arr + count, value);
+        ++count;
+    }
+
+    void pushUnchecked(T&& value) {
+        assert(count < cap);
+        AllocTraits::construct(alloc, arr + count, std::move(value));
+        ++count;
+    }
+
+    T popUnchecked() {
+        assert(count > 0);
+        T value(std::move(arr[count - 1]));
+        AllocTraits::destroy(alloc, arr + --count);
+        return value;
+    }
+
+    // Pushes [first, last) in order, so the last element ends up on top.
+    // Forward ranges cost a single capacity check, and contiguous ranges of
+    // trivially copyable T are copied with one memcpy. The range must not
+    // point into this stack.
+    template <typename InputIt>
+    void pushRange(InputIt first, InputIt last) {
+        pushRange(first, last, typename std::iterator_traits<InputIt>::iterator_category());
+    }
+
+    // Removes the top n elements and writes them to out in the order they
+    // were pushed, so popN undoes a pushRange of the same length. Throws
+    // underflow_error and leaves the stack untouched if fewer than n remain.
+    template <typename OutputIt>
+    OutputIt popN(std::size_t n, OutputIt out) {
+        if (n > count) {
+            throwStackUnderflow();
+        }
+        T* first = arr + (count - n);
+        if constexpr (isTrivialBlockOf<OutputIt>()) {
+            if (n > 0) {
+                std::memcpy(out, first, n * sizeof(T));
+            }
+            out += n;
+        } else {
+            for (std::size_t i = 0; i < n; ++i, ++out) {
+                *out = std::move(first[i]);
+            }
+        }
+        if constexpr (std::is_trivially_destructible<T>::value) {
+            count -= n;
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                AllocTraits::destroy(alloc, arr + --count);
+            }
+        }
+        return out;
+    }
+
+    T& peek() {
+        if (isEmpty()) {
+            throwStackUnderflow();
+        }
+        return arr[count - 1];
+    }
+
+    const T& peek() const {
+        if (isEmpty()) {
+            throwStackUnderflow();
         }
-        return arr[top--];
+        return arr[count - 1];
+    }
+
+    // Destroys every element but keeps the buffer for reuse.
+    void clear() {
+        destroyAll();
     }
 
     bool isEmpty() const {
-        return top == -1;
+        return count == 0;
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    std::size_t capacity() const {
+        return cap;
+    }
+
+    // Ensures room for at least newCap elements without further allocation.
+    void reserve(std::size_t newCap) {
+        if (newCap > AllocTraits::max_size(alloc)) {
+            throwStackOverflow("Stack overflow");
+        }
+        if (newCap > cap) {
+            reallocate(newCap);
+        }
+    }
+
+    // Drops unused capacity. Once the elements fit in the inline buffer
+    // they move back there and the heap buffer is freed entirely.
+    void shrinkToFit() {
+        if (count == cap || isInline()) {
+            return;
+        }
+        if (count <= InlineCapacity) {
+            relocateInto(this->inlineData());
+            adopt(this->inlineData(), count, InlineCapacity);
+            return;
+        }
+        reallocate(count);
+    }
+
+    Allocator getAllocator() const {
+        return alloc;
+    }
+};
+
+// Stack that keeps its first N elements inline, for the common case of a
+// handful of entries (bracket matching within a line) with no heap traffic.
+template <typename T, std::size_t N, typename Allocator = std::allocator<T> >
+using SmallStack = Stack<T, Allocator, N>;
+
+// Bump-pointer arena for per-request scratch data: the stacks a parser
+// needs while it handles one request. Allocation advances a cursor through
+// a chain of blocks, and reset() rewinds it to the first block in O(1),
+// keeping every block for the next request, so a warm arena never touches
+// the heap. deallocate() gives back only the most recent allocation, which
+// is enough for scratch stacks destroyed in reverse order of creation; any
+// other freed buffer (such as the one a growing Stack leaves behind) stays
+// used until reset(). Blocks and allocations are cache-line aligned. Blocks
+// are first written by the thread using the arena, so with the kernel's
+// default first-touch policy an arena kept per thread is NUMA-local to it.
+// Not thread-safe, and neither copyable nor movable, since allocators point
+// at it.
+class MonotonicArena {
+public:
+    static constexpr std::size_t cacheLineSize = 64;
+
+private:
+    struct Block {
+        Block* next;
+        std::size_t size; // usable bytes after the header
+
+        unsigned char* data() {
+            return reinterpret_cast<unsigned char*>(this) + headerSize;
+        }
+    };
+
+    static constexpr std::size_t headerSize = (sizeof(Block) + cacheLineSize - 1) / cacheLineSize * cacheLineSize;
+    static constexpr std::size_t maxBlockSize = std::size_t(1) << 20;
+
+    Block* first;
+    Block* current;
+    std::size_t offset;     // cursor within current
+    std::size_t nextSize;   // size of the next block to allocate
+    std::size_t used;
+    std::size_t reserved;
+
+    // Adds a block of at least minBytes after the last one and makes it
+    // current. Block sizes double up to maxBlockSize.
+    void appendBlock(std::size_t minBytes) {
+        const std::size_t size = minBytes > nextSize ? minBytes : nextSize;
+        if (size > std::numeric_limits<std::size_t>::max() - headerSize) {
+            throw std::bad_alloc();
+        }
+        Block* block = static_cast<Block*>(::operator new(headerSize + size, std::align_val_t(cacheLineSize)));
+        block->next = nullptr;
+        block->size = size;
+        if (current) {
+            current->next = block;
+        } else {
+            first = block;
+        }
+        current = block;
+        offset = 0;
+        reserved += size;
+        if (nextSize < maxBlockSize) {
+            nextSize *= 2;
+        }
+    }
+
+public:
+    explicit MonotonicArena(std::size_t initialBlockSize = 4096)
+        : first(nullptr), current(nullptr), offset(0),
+          nextSize(initialBlockSize < cacheLineSize ? cacheLineSize : initialBlockSize), used(0), reserved(0) {}
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    ~MonotonicArena() {
+        release();
+    }
+
+    // alignment must be a power of two
+    void* allocate(std::size_t bytes, std::size_t alignment = cacheLineSize) {
+        for (;;) {
+            if (current) {
+                const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(current->data());
+                const std::uintptr_t start = (base + offset + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+                const std::size_t begin = start - base;
+                if (begin <= current->size && bytes <= current->size - begin) {
+                    used += begin + bytes - offset;
+                    offset = begin + bytes;
+                    return current->data() + begin;
+                }
+                if (current->next) {
+                    // A block kept from before the last reset()
+                    current = current->next;
+                    offset = 0;
+                    continue;
+                }
+            }
+            if (bytes > std::numeric_limits<std::size_t>::max() - alignment) {
+                throw std::bad_alloc();
+            }
+            appendBlock(bytes + alignment);
+        }
+    }
+
+    void deallocate(void* p, std::size_t bytes) noexcept {
+        unsigned char* end = static_cast<unsigned char*>(p) + bytes;
+        if (current && end == current->data() + offset) {
+            const std::size_t begin = static_cast<std::size_t>(static_cast<unsigned char*>(p) - current->data());
+            used -= offset - begin;
+            offset = begin;
+        }
+    }
+
+    // Forgets every allocation. The blocks are kept for reuse.
+    void reset() noexcept {
+        current = first;
+        offset = 0;
+        used = 0;
+    }
+
+    // Forgets every allocation and frees the blocks.
+    void release() noexcept {
+        while (first) {
+            Block* next = first->next;
+            ::operator delete(static_cast<void*>(first), std::align_val_t(cacheLineSize));
+            first = next;
+        }
+        current = nullptr;
+        offset = 0;
+        used = 0;
+        reserved = 0;
+    }
+
+    // Bytes handed out (alignment padding included) since the last reset()
+    std::size_t bytesUsed() const {
+        return used;
+    }
+
+    // Bytes held in blocks
+    std::size_t bytesReserved() const {
+        return reserved;
+    }
+};
+
+// Allocator drawing from a MonotonicArena, with every buffer starting on a
+// cache line. Copies share the arena and propagate with the container, so
+// moving an arena-backed Stack always steals its buffer.
+template <typename T>
+class ArenaAllocator {
+private:
+    template <typename U> friend class ArenaAllocator;
+
+    static constexpr std::size_t alignment =
+        alignof(T) > MonotonicArena::cacheLineSize ? alignof(T) : MonotonicArena::cacheLineSize;
+
+    MonotonicArena* arena;
+
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::false_type is_always_equal;
+
+    // Implicit, like std::pmr::polymorphic_allocator's, so that a Stack
+    // can be constructed straight from the arena
+    ArenaAllocator(MonotonicArena& a) noexcept : arena(&a) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(std::size_t n) {
+        if (n > max_size()) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignment));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        arena->deallocate(p, n * sizeof(T));
+    }
+
+    std::size_t max_size() const noexcept {
+        return std::numeric_limits<std::size_t>::max() / sizeof(T);
+    }
+
+    MonotonicArena& resource() const noexcept {
+        return *arena;
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+        return arena != other.arena;
+    }
+};
+
+// Stack whose heap buffer comes from an arena; construct it with one
+// (ArenaStack<int> stack(arena)). With N > 0 the first
+// N elements stay inline, as in SmallStack.
+template <typename T, std::size_t N = 0>
+using ArenaStack = Stack<T, ArenaAllocator<T>, N>;
+
+// Fixed-capacity stack: the old MAX_SIZE array with the capacity turned into
+// a template parameter. Every operation is constexpr, so for literal T it
+// can be used in constant expressions. Like the original array it holds N
+// value-initialized slots, so it suits small scalar element types.
+template <typename T, std::size_t N>
+class FixedStack {
+    static_assert(N > 0, "FixedStack needs a non-zero capacity");
+
+private:
+    T arr[N];
+    std::size_t count;
+
+public:
+    constexpr FixedStack() : arr(), count(0) {}
+
+    constexpr void push(const T& value) {
+        if (count >= N) {
+            throwStackOverflow("Stack is full");
+        }
+        pushUnchecked(value);
+    }
+
+    constexpr void push(T&& value) {
+        if (count >= N) {
+            throwStackOverflow("Stack is full");
+        }
+        pushUnchecked(std::move(value));
+    }
+
+    constexpr T pop() {
+        if (isEmpty()) {
+            throwStackUnderflow();
+        }
+        return popUnchecked();
+    }
+
+    constexpr bool tryPush(const T& value) {
+        if (count >= N) {
+            return false;
+        }
+        pushUnchecked(value);
+        return true;
+    }
+
+    constexpr bool tryPush(T&& value) {
+        if (count >= N) {
+            return false;
+        }
+        pushUnchecked(std::move(value));
+        return true;
+    }
+
+    constexpr std::optional<T> tryPop() {
+        if (isEmpty()) {
+            return std::nullopt;
+        }
+        return std::optional<T>(popUnchecked());
+    }
+
+    constexpr void pushUnchecked(const T& value) {
+        assert(count < N);
+        arr[count++] = value;
+    }
+
+    constexpr void pushUnchecked(T&& value) {
+        assert(count < N);
+        arr[count++] = std::move(value);
+    }
+
+    constexpr T popUnchecked() {
+        assert(count > 0);
+        return std::move(arr[--count]);
+    }
+
+    constexpr T& peek() {
+        if (isEmpty()) {
+            throwStackUnderflow();
+        }
+        return arr[count - 1];
+    }
+
+    constexpr const T& peek() const {
+        if (isEmpty()) {
+            throwStackUnderflow();
+        }
+        return arr[count - 1];
+    }
+
+    constexpr void clear() {
+        count = 0;
+    }
+
+    constexpr bool isEmpty() const {
+        return count == 0;
+    }
+
+    constexpr std::size_t size() const {
+        return count;
+    }
+
+    static constexpr std::size_t capacity() {
+        return N;
+    }
+};
+
+// Many small fixed-capacity stacks in one buffer, structure-of-arrays
+// style: stack k's slots are the contiguous run data[k * stride ...] and
+// every stack's size sits in one shared tops array. A batch of hundreds of
+// bracket stacks (one per submission or per line) then costs two
+// allocations instead of hundreds, and a pass over stack k touches only its
+// own few cache lines. The bulk operations take one value per stack and
+// run branch-free over the tops array: the top updates vectorize, and the
+// element moves are one strided access per stack. Each stack has a
+// spare slot past its capacity that the masked bulk operations may write,
+// and the stride is rounded up to whole cache lines (element sizes that
+// divide 64); with an ArenaAllocator the stacks then also start on cache
+// lines. T must be trivial. Slots are left uninitialized, so building a
+// MultiStack touches only its tops array and a stack's cache lines are
+// first touched when it is used.
+template <typename T, typename Allocator = std::allocator<T> >
+class MultiStack {
+    static_assert(std::is_trivial<T>::value, "MultiStack holds trivial elements");
+
+private:
+    typedef std::allocator_traits<Allocator> AllocTraits;
+    typedef typename AllocTraits::template rebind_alloc<std::size_t> TopsAllocator;
+    typedef std::allocator_traits<TopsAllocator> TopsTraits;
+
+    static constexpr std::size_t lineElements =
+        64 % sizeof(T) == 0 ? 64 / sizeof(T) : 1;
+
+    Allocator alloc;
+    TopsAllocator topsAlloc;
+    std::size_t stacks;
+    std::size_t depth;  // capacity of each stack
+    std::size_t stride; // slots per stack, spare slot included
+    T* data;
+    std::size_t* tops;
+
+    std::size_t slots() const {
+        return stacks * stride;
+    }
+
+    T* base(std::size_t k) {
+        return data + k * stride;
+    }
+
+    const T* base(std::size_t k) const {
+        return data + k * stride;
+    }
+
+    void freeBuffers() {
+        if (data) {
+            AllocTraits::deallocate(alloc, data, slots());
+        }
+        if (tops) {
+            TopsTraits::deallocate(topsAlloc, tops, stacks);
+        }
+    }
+
+public:
+    // A handle to stack k with the usual Stack surface, for code written
+    // against a single stack. It stays valid while the MultiStack lives
+    // and is not moved.
+    class StackView {
+    private:
+        T* slots;
+        std::size_t* top;
+        std::size_t depth;
+
+    public:
+        StackView(MultiStack& multi, std::size_t k)
+            : slots(multi.base(k)), top(multi.tops + k), depth(multi.depth) {}
+
+        void push(const T& value) {
+            if (*top >= depth) {
+                throwStackOverflow("Stack is full");
+            }
+            pushUnchecked(value);
+        }
+
+        T pop() {
+            if (isEmpty()) {
+                throwStackUnderflow();
+            }
+            return popUnchecked();
+        }
+
+        bool tryPush(const T& value) {
+            if (*top >= depth) {
+                return false;
+            }
+            pushUnchecked(value);
+            return true;
+        }
+
+        std::optional<T> tryPop() {
+            if (isEmpty()) {
+                return std::nullopt;
+            }
+            return std::optional<T>(popUnchecked());
+        }
+
+        void pushUnchecked(const T& value) {
+            assert(*top < depth);
+            slots[(*top)++] = value;
+        }
+
+        T popUnchecked() {
+            assert(*top > 0);
+            return slots[--*top];
+        }
+
+        T& peek() {
+            if (isEmpty()) {
+                throwStackUnderflow();
+            }
+            return slots[*top - 1];
+        }
+
+        void clear() {
+            *top = 0;
+        }
+
+        bool isEmpty() const {
+            return *top == 0;
+        }
+
+        std::size_t size() const {
+            return *top;
+        }
+
+        std::size_t capacity() const {
+            return depth;
+        }
+    };
+
+    MultiStack(std::size_t stackCount, std::size_t capacityPerStack, const Allocator& allocator = Allocator())
+        : alloc(allocator), topsAlloc(allocator), stacks(stackCount), depth(capacityPerStack),
+          stride((capacityPerStack + 1 + lineElements - 1) / lineElements * lineElements),
+          data(nullptr), tops(nullptr) {
+        if (stacks != 0 && stride > AllocTraits::max_size(alloc) / stacks) {
+            throwStackOverflow("MultiStack too large");
+        }
+        if (stacks == 0) {
+            return;
+        }
+        try {
+            data = AllocTraits::allocate(alloc, slots());
+            tops = TopsTraits::allocate(topsAlloc, stacks);
+        } catch (...) {
+            freeBuffers();
+            throw;
+        }
+        std::uninitialized_default_construct_n(data, slots());
+        std::uninitialized_value_construct_n(tops, stacks);
+    }
+
+    MultiStack(const MultiStack&) = delete;
+    MultiStack& operator=(const MultiStack&) = delete;
+
+    MultiStack(MultiStack&& other) noexcept
+        : alloc(std::move(other.alloc)), topsAlloc(std::move(other.topsAlloc)), stacks(other.stacks),
+          depth(other.depth), stride(other.stride), data(other.data), tops(other.tops) {
+        other.stacks = 0;
+        other.data = nullptr;
+        other.tops = nullptr;
+    }
+
+    ~MultiStack() {
+        freeBuffers();
+    }
+
+    StackView operator[](std::size_t k) {
+        assert(k < stacks);
+        return StackView(*this, k);
+    }
+
+    void push(std::size_t k, const T& value) {
+        if (tops[k] >= depth) {
+            throwStackOverflow("Stack is full");
+        }
+        pushUnchecked(k, value);
+    }
+
+    T pop(std::size_t k) {
+        if (isEmpty(k)) {
+            throwStackUnderflow();
+        }
+        return popUnchecked(k);
+    }
+
+    bool tryPush(std::size_t k, const T& value) {
+        if (tops[k] >= depth) {
+            return false;
+        }
+        pushUnchecked(k, value);
+        return true;
+    }
+
+    std::optional<T> tryPop(std::size_t k) {
+        if (isEmpty(k)) {
+            return std::nullopt;
+        }
+        return std::optional<T>(popUnchecked(k));
+    }
+
+    void pushUnchecked(std::size_t k, const T& value) {
+        assert(k < stacks && tops[k] < depth);
+        base(k)[tops[k]++] = value;
+    }
+
+    T popUnchecked(std::size_t k) {
+        assert(k < stacks && tops[k] > 0);
+        return base(k)[--tops[k]];
+    }
+
+    T& peek(std::size_t k) {
+        if (isEmpty(k)) {
+            throwStackUnderflow();
+        }
+        return base(k)[tops[k] - 1];
+    }
+
+    const T& peek(std::size_t k) const {
+        if (isEmpty(k)) {
+            throwStackUnderflow();
+        }
+        return base(k)[tops[k] - 1];
+    }
+
+    // Pushes values[k] onto every stack k, or only onto those whose
+    // mask[k] is non-zero. Throws, with every stack as it was, if one of
+    // them is full. Each pass is a plain loop over the stacks: values go
+    // into the slot just above each top first (the spare slot, if a stack
+    // is full or masked out), and only then do the tops move.
+    void pushAll(const T* values, const std::uint8_t* mask = nullptr) {
+        bool full = false;
+        T* slot = data;
+        for (std::size_t k = 0; k < stacks; ++k, slot += stride) {
+            slot[tops[k]] = values[k];
+            full |= (!mask || mask[k]) & (tops[k] >= depth);
+        }
+        if (full) {
+            throwStackOverflow("Stack is full");
+        }
+        if (!mask) {
+            for (std::size_t k = 0; k < stacks; ++k) {
+                ++tops[k];
+            }
+            return;
+        }
+        for (std::size_t k = 0; k < stacks; ++k) {
+            tops[k] += mask[k] != 0;
+        }
+    }
+
+    // Pops the top of every stack k into out[k], or only of those whose
+    // mask[k] is non-zero; the other entries of out are left alone.
+    // Throws before changing anything if one of them is empty.
+    void popAll(T* out, const std::uint8_t* mask = nullptr) {
+        bool empty = false;
+        for (std::size_t k = 0; k < stacks; ++k) {
+            empty |= (!mask || mask[k]) & (tops[k] == 0);
+        }
+        if (empty) {
+            throwStackUnderflow();
+        }
+        const T* slot = data;
+        if (!mask) {
+            for (std::size_t k = 0; k < stacks; ++k) {
+                --tops[k];
+            }
+            for (std::size_t k = 0; k < stacks; ++k, slot += stride) {
+                out[k] = slot[tops[k]];
+            }
+            return;
+        }
+        for (std::size_t k = 0; k < stacks; ++k, slot += stride) {
+            const bool selected = mask[k] != 0;
+            tops[k] -= selected;
+            out[k] = selected ? slot[tops[k]] : out[k];
+        }
+    }
+
+    void clear(std::size_t k) {
+        tops[k] = 0;
+    }
+
+    void clearAll() {
+        std::fill(tops, tops + stacks, std::size_t(0));
+    }
+
+    bool isEmpty(std::size_t k) const {
+        return tops[k] == 0;
+    }
+
+    std::size_t size(std::size_t k) const {
+        return tops[k];
+    }
+
+    // Stack k's elements, bottom first
+    const T* elements(std::size_t k) const {
+        return base(k);
+    }
+
+    std::size_t stackCount() const {
+        return stacks;
+    }
+
+    // Capacity of each stack
+    std::size_t capacity() const {
+        return depth;
+    }
+};
+
+// Lock-free Treiber stack for sharing items between threads. Each list head
+// is a (node, tag) pair swapped with a double-width compare-and-swap, and
+// the tag is bumped on every update, so a node that is popped and pushed
+// again between another thread's load and CAS cannot be mistaken for the
+// old head (ABA). Popped nodes are recycled through an internal free list
+// instead of being deleted, so a racing pop that still reads node->next
+// never touches freed memory; nodes are released by the destructor.
+//
+// On x86-64 build with -mcx16 (and link -latomic) to get cmpxchg16b.
+template <typename T>
+class ConcurrentStack {
+private:
+    struct Node {
+        std::atomic<Node*> next;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        Node() : next(nullptr) {}
+
+        T* value() {
+            return reinterpret_cast<T*>(storage);
+        }
+    };
+
+    struct alignas(2 * sizeof(void*)) TaggedPtr {
+        Node* node;
+        std::uintptr_t tag;
+    };
+
+    // Separate cache lines so pushers and the free list do not false-share.
+    alignas(64) std::atomic<TaggedPtr> head;
+    alignas(64) std::atomic<TaggedPtr> freeList;
+
+    static void pushNode(std::atomic<TaggedPtr>& list, Node* node) {
+        TaggedPtr old = list.load(std::memory_order_relaxed);
+        TaggedPtr desired;
+        do {
+            node->next.store(old.node, std::memory_order_relaxed);
+            desired.node = node;
+            desired.tag = old.tag + 1;
+        } while (!list.compare_exchange_weak(old, desired,
+                                             std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // old.node->next may be read after another thread has already popped
+    // and recycled the node; the value is then stale but the tag makes the
+    // CAS fail, and the node itself is never freed while the stack lives.
+    static Node* popNode(std::atomic<TaggedPtr>& list) {
+        TaggedPtr old = list.load(std::memory_order_acquire);
+        TaggedPtr desired;
+        do {
+            if (!old.node) {
+                return nullptr;
+            }
+            desired.node = old.node->next.load(std::memory_order_relaxed);
+            desired.tag = old.tag + 1;
+        } while (!list.compare_exchange_weak(old, desired,
+                                             std::memory_order_acquire, std::memory_order_acquire));
+        return old.node;
+    }
+
+    Node* acquireNode() {
+        Node* node = popNode(freeList);
+        return node ? node : new Node();
+    }
+
+    static void deleteAll(std::atomic<TaggedPtr>& list, bool destroyValues) {
+        Node* node = list.load(std::memory_order_relaxed).node;
+        while (node) {
+            Node* next = node->next.load(std::memory_order_relaxed);
+            if (destroyValues) {
+                node->value()->~T();
+            }
+            delete node;
+            node = next;
+        }
+    }
+
+public:
+    ConcurrentStack() : head(TaggedPtr{nullptr, 0}), freeList(TaggedPtr{nullptr, 0}) {}
+
+    ConcurrentStack(const ConcurrentStack&) = delete;
+    ConcurrentStack& operator=(const ConcurrentStack&) = delete;
+
+    // Not thread-safe: no other thread may still be using the stack.
+    ~ConcurrentStack() {
+        deleteAll(head, true);
+        deleteAll(freeList, false);
+    }
+
+    void push(const T& value) {
+        emplace(value);
+    }
+
+    void push(T&& value) {
+        emplace(std::move(value));
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        Node* node = acquireNode();
+        try {
+            ::new (static_cast<void*>(node->storage)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            pushNode(freeList, node);
+            throw;
+        }
+        pushNode(head, node);
+    }
+
+    bool tryPop(T& out) {
+        Node* node = popNode(head);
+        if (!node) {
+            return false;
+        }
+        out = std::move(*node->value());
+        node->value()->~T();
+        pushNode(freeList, node);
+        return true;
+    }
+
+    std::optional<T> tryPop() {
+        Node* node = popNode(head);
+        if (!node) {
+            return std::nullopt;
+        }
+        std::optional<T> value(std::move(*node->value()));
+        node->value()->~T();
+        pushNode(freeList, node);
+        return value;
+    }
+
+    // A snapshot: other threads may push or pop right after it is taken.
+    bool isEmpty() const {
+        return head.load(std::memory_order_acquire).node == nullptr;
+    }
+
+    bool isLockFree() const {
+        return head.is_lock_free();
     }
 };
 
-#endif // STACK_HPP 
\ No newline at end of file
+#endif // STACK_HPP
@@ -0,0 +1,93 @@
+const { parentPort } = require('worker_threads');
+const { parse: babelParse } = require('@babel/parser');
+
+// Babel runs here, in a worker thread, so that parsing a large submission
+// never blocks the server's event loop (see JavaScriptWorkerPool in
+// server.js). Sources arrive as UTF-8 bytes in a transferred buffer.
+
+// JavaScript syntax checker
+function checkJavaScriptSyntax(code) {
+    // Check code size
+    if (code.length > 1000000) { // 1MB limit
+        return {
+            valid: false,
+            error: 'Code size exceeds maximum limit of 1MB'
+        };
+    }
+
+    try {
+        // First try as a module with all features
+        try {
+            babelParse(code, {
+                sourceType: 'module',
+                allowReturnOutsideFunction: true,
+                allowAwaitOutsideFunction: true,
+                allowSuperOutsideMethod: true,
+                allowUndeclaredExports: true,
+                plugins: [
+                    'jsx',
+                    'typescript',
+                    'classProperties',
+                    'privateClassMethods',
+                    'classStaticBlock',
+                    'nullishCoalescingOperator',
+                    'optionalChaining',
+                    ['decorators', { decoratorsBeforeExport: true }]
+                ]
+            });
+            return { valid: true, message: 'Syntax is valid' };
+        } catch (moduleError) {
+            // If module parsing fails, try as script
+            try {
+                babelParse(code, {
+                    sourceType: 'script',
+                    allowReturnOutsideFunction: true,
+                    plugins: [
+                        'jsx',
+                        'typescript',
+                        'decorators-legacy',
+                        'classProperties',
+                        'privateClassMethods',
+                        'classStaticBlock',
+                        'nullishCoalescingOperator',
+                        'optionalChaining',
+                        ['decorators', { decoratorsBeforeExport: true }]
+                    ]
+                });
+                return { valid: true, message: 'Syntax is valid' };
+            } catch (scriptError) {
+                // Return the more relevant error message
+                const error = scriptError.code === 'BABEL_PARSER_SYNTAX_ERROR' ? scriptError : moduleError;
+                return {
+                    valid: false,
+                    error: error.message.split('\n')[0],
+                    line: error.loc?.line || 1,
+                    column: error.loc?.column || 0,
+                    details: {
+                        message: error.message,
+                        type: error.code || 'SyntaxError',
+                        loc: error.loc
+                    }
+                };
+            }
+        }
+    } catch (error) {
+        return {
+            valid: false,
+            error: error.message,
+            details: {
+                message: error.message,
+                type: 'Error'
+            }
+        };
+    }
+}
+
+if (parentPort) {
+    const decoder = new TextDecoder();
+    parentPort.on('message', ({ id, source }) => {
+        parentPort.postMessage({ id, result: checkJavaScriptSyntax(decoder.decode(source)) });
+    });
+}
+
+module.exports = { checkJavaScriptSyntax };
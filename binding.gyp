@@ -0,0 +1,18 @@
+{
+  "targets": [
+    {
+      "target_name": "precheck",
+      "sources": ["precheck.cc"],
+      "include_dirs": ["."],
+      "cflags_cc!": ["-fno-exceptions", "-std=gnu++14"],
+      "cflags_cc": ["-std=c++17", "-fexceptions", "-O2"],
+      "xcode_settings": {
+        "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+        "CLANG_CXX_LANGUAGE_STANDARD": "c++17"
+      },
+      "msvs_settings": {
+        "VCCLCompilerTool": { "ExceptionHandling": 1, "AdditionalOptions": ["/std:c++17"] }
+      }
+    }
+  ]
+}
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Stack.hpp"
+
+// Build: g++ -std=c++17 -O2 -pthread concurrent_stack_tests.cpp -latomic
+// (add -mcx16 on x86-64 for a lock-free double-width CAS)
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+static unsigned threadCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n < 4 ? 4 : n;
+}
+
+// Test Case 1: Single-Threaded Behaviour
+void testSingleThreaded() {
+    std::cout << "\n=== Test Case 1: Single-Threaded Behaviour ===\n";
+    ConcurrentStack<std::string> stack;
+    std::cout << "Lock-free head: " << (stack.isLockFree() ? "Yes" : "No (routed through libatomic)") << "\n";
+    std::cout << "Is empty? " << (stack.isEmpty() ? "Yes" : "No") << "\n";
+
+    stack.push("a");
+    stack.push(std::string("b"));
+    stack.emplace(1, 'c');
+
+    std::cout << "Popping values: ";
+    std::string value;
+    std::string order;
+    while (stack.tryPop(value)) {
+        std::cout << value << " ";
+        order += value;
+    }
+    std::cout << "\n";
+    check(order == "cba", "single-threaded pops are not LIFO");
+    check(!stack.tryPop().has_value(), "tryPop on an empty stack returned a value");
+}
+
+// Test Case 2: Producers and Consumers
+// Every value pushed under contention must be popped exactly once: the
+// stack may neither lose an element nor hand the same one out twice.
+void testProducersAndConsumers() {
+    std::cout << "\n=== Test Case 2: Producers and Consumers ===\n";
+    const unsigned producers = threadCount() / 2;
+    const unsigned consumers = threadCount() - producers;
+    const std::uint64_t perProducer = 200000;
+
+    ConcurrentStack<std::uint64_t> stack;
+    std::atomic<unsigned> producersDone(0);
+    std::vector<std::vector<std::uint64_t> > popped(consumers);
+    std::vector<std::thread> threads;
+
+    for (unsigned p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (std::uint64_t seq = 0; seq < perProducer; ++seq) {
+                stack.push((static_cast<std::uint64_t>(p) << 32) | seq);
+            }
+            producersDone.fetch_add(1);
+        });
+    }
+    for (unsigned c = 0; c < consumers; ++c) {
+        threads.emplace_back([&, c]() {
+            std::uint64_t value;
+            for (;;) {
+                if (stack.tryPop(value)) {
+                    popped[c].push_back(value);
+                } else if (producersDone.load() == producers && stack.isEmpty()) {
+                    break;
+                }
+            }
+        });
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    std::vector<std::uint64_t> all;
+    for (size_t c = 0; c < popped.size(); ++c) {
+        all.insert(all.end(), popped[c].begin(), popped[c].end());
+    }
+    std::sort(all.begin(), all.end());
+    std::cout << producers << " producers, " << consumers << " consumers, popped "
+              << all.size() << " of " << producers * perProducer << "\n";
+
+    check(all.size() == producers * perProducer, "elements were lost or duplicated");
+    check(std::adjacent_find(all.begin(), all.end()) == all.end(), "an element was popped twice");
+    for (unsigned p = 0; p < producers; ++p) {
+        for (std::uint64_t seq = 0; seq < perProducer; ++seq) {
+            check(all[p * perProducer + seq] == ((static_cast<std::uint64_t>(p) << 32) | seq),
+                  "popped a value that was never pushed");
+        }
+    }
+    std::cout << "Every pushed value was popped exactly once\n";
+}
+
+// Test Case 3: ABA Torture
+// A tiny stack whose nodes are recycled constantly: every thread pops a
+// value and pushes it straight back. Without the head tag a stale CAS
+// would splice a recycled node in and drop or duplicate elements.
+void testNodeRecycling() {
+    std::cout << "\n=== Test Case 3: ABA Torture ===\n";
+    const int values = 3;
+    const int rounds = 300000;
+    ConcurrentStack<int> stack;
+    for (int i = 0; i < values; ++i) {
+        stack.push(i);
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount(); ++t) {
+        threads.emplace_back([&]() {
+            for (int r = 0; r < rounds; ++r) {
+                std::optional<int> value = stack.tryPop();
+                if (value) {
+                    stack.push(*value);
+                }
+            }
+        });
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    std::vector<int> remaining;
+    int value;
+    while (stack.tryPop(value)) {
+        remaining.push_back(value);
+    }
+    std::sort(remaining.begin(), remaining.end());
+    std::cout << "Values left after " << threadCount() << " x " << rounds << " pop/push rounds: ";
+    for (size_t i = 0; i < remaining.size(); ++i) {
+        std::cout << remaining[i] << " ";
+    }
+    std::cout << "\n";
+
+    check(remaining.size() == static_cast<size_t>(values), "node recycling lost or duplicated elements");
+    for (int i = 0; i < values; ++i) {
+        check(remaining[i] == i, "node recycling corrupted an element");
+    }
+}
+
+int main() {
+    try {
+        testSingleThreaded();
+        testProducersAndConsumers();
+        testNodeRecycling();
+
+        std::cout << "\nAll tests completed successfully!\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,437 @@
+// Load generator and latency benchmark for the syntax checker server.
+//
+// Replays the test.js cases plus a generated corpus against /check-syntax,
+// with a fixed number of connections in flight and, optionally, a target
+// request rate. Reports p50/p95/p99 latency, throughput and error rate per
+// language as JSON on stdout (a summary table goes to stderr), so a run can
+// be saved as a baseline and later runs gated against it. With
+// --stack-bench it also runs the C++ Stack benchmarks and folds their
+// results into the same report.
+//
+//   node loadtest.js --url http://localhost:3000 --duration 30 --concurrency 16 \
+//       --rps 200 --mix javascript=4,python=2,cpp=2,c=1,java=1 > report.json
+//   node loadtest.js --baseline report.json --tolerance 0.15   # exits 1 on a regression
+//   node loadtest.js --stack-bench --requests 0                 # Stack benchmarks only
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { execFileSync } = require('child_process');
+const { performance } = require('perf_hooks');
+const { tests } = require('./test.js');
+
+const DEFAULTS = {
+    url: 'http://localhost:3000',
+    apiKey: 'test-key',
+    duration: 30,           // seconds, unless --requests is given
+    requests: null,
+    warmup: 2,              // seconds of traffic left out of the statistics
+    concurrency: 8,         // requests in flight at most
+    rps: 0,                 // target arrival rate; 0 sends as fast as the connections allow
+    mix: 'javascript=1,python=1,java=1,cpp=1,c=1',
+    corpus: 'all',          // 'test', 'generated' or 'all'
+    generated: 200,         // generated programs per language
+    unique: true,           // make every request unique so the result cache does not answer it
+    timeout: 60,            // seconds per request
+    stackBench: null,       // path to stack_bench (built from stack_bench.cpp if missing)
+    stackBenchMinTime: 0.2,
+    stackBenchFilter: '',
+    baseline: null,
+    tolerance: 0.1,
+    seed: 1
+};
+
+const USAGE = `Usage: node loadtest.js [options]
+  --url <url>                 server to load (${DEFAULTS.url})
+  --api-key <key>             x-api-key header (${DEFAULTS.apiKey})
+  --duration <s>              measured run time (${DEFAULTS.duration})
+  --requests <n>              stop after n measured requests instead
+  --warmup <s>                unmeasured traffic first (${DEFAULTS.warmup})
+  --concurrency <n>           requests in flight at most (${DEFAULTS.concurrency})
+  --rps <n>                   target request rate, 0 for closed loop (${DEFAULTS.rps})
+  --mix <lang=weight,...>     language mix (${DEFAULTS.mix})
+  --corpus <test|generated|all>
+  --generated <n>             generated programs per language (${DEFAULTS.generated})
+  --no-unique                 replay identical code (measures cache hits)
+  --timeout <s>               per-request timeout (${DEFAULTS.timeout})
+  --stack-bench [path]        also run the C++ Stack benchmarks
+  --stack-bench-min-time <s>  per-benchmark time (${DEFAULTS.stackBenchMinTime})
+  --stack-bench-filter <text> only benchmarks whose name contains text
+  --baseline <report.json>    compare with an earlier report, exit 1 on a regression
+  --tolerance <fraction>      allowed slowdown against the baseline (${DEFAULTS.tolerance})
+  --seed <n>                  corpus and mix order (${DEFAULTS.seed})`;
+
+function parseArgs(argv) {
+    const options = { ...DEFAULTS };
+    const camel = flag => flag.replace(/-([a-z])/g, (_, c) => c.toUpperCase());
+    for (let i = 0; i < argv.length; i++) {
+        const arg = argv[i];
+        if (arg === '--help' || arg === '-h') {
+            console.error(USAGE);
+            process.exit(0);
+        } else if (arg === '--no-unique') {
+            options.unique = false;
+        } else if (arg === '--stack-bench') {
+            options.stackBench = argv[i + 1] && !argv[i + 1].startsWith('--') ? argv[++i] : path.join(__dirname, 'stack_bench');
+        } else if (arg.startsWith('--') && camel(arg.slice(2)) in DEFAULTS && i + 1 < argv.length) {
+            const key = camel(arg.slice(2));
+            const value = argv[++i];
+            options[key] = typeof DEFAULTS[key] === 'number' || key === 'requests' ? Number(value) : value;
+        } else {
+            console.error(`Unknown option: ${arg}\n${USAGE}`);
+            process.exit(2);
+        }
+    }
+    return options;
+}
+
+// Small deterministic PRNG (mulberry32), so a seed replays the same run
+function random(seed) {
+    let state = seed >>> 0;
+    return () => {
+        state = (state + 0x6d2b79f5) >>> 0;
+        let t = state;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+}
+
+function parseMix(spec) {
+    const mix = [];
+    for (const entry of spec.split(',')) {
+        const [language, weight] = entry.split('=').map(part => part.trim());
+        if (language && Number(weight) > 0) {
+            mix.push({ language, weight: Number(weight) });
+        }
+    }
+    return mix;
+}
+
+// Generated programs: a few helper functions (more for later entries, so
+// sizes vary) and a main that uses them. Every third one is broken, half
+// of those in a way the compiler must find (a missing semicolon or colon)
+// and half with an unbalanced brace (Python keeps the missing colon).
+const GENERATORS = {
+    javascript: (n, functions) => {
+        const helpers = Array.from({ length: functions }, (_, k) =>
+            `function f${k}(values) {\n    let total = 0;\n    for (const v of values) {\n        total += v * ${k + n};\n    }\n    return total;\n}\n`);
+        return `${helpers.join('\n')}\nconsole.log(f0([1, 2, 3]));\n`;
+    },
+    python: (n, functions) => {
+        const helpers = Array.from({ length: functions }, (_, k) =>
+            `def f${k}(values):\n    total = 0\n    for v in values:\n        total += v * ${k + n}\n    return total\n`);
+        return `${helpers.join('\n')}\nprint(f0([1, 2, 3]))\n`;
+    },
+    java: (n, functions) => {
+        const helpers = Array.from({ length: functions }, (_, k) =>
+            `    static int f${k}(int[] values) {\n        int total = 0;\n        for (int v : values) {\n            total += v * ${k + n};\n        }\n        return total;\n    }\n`);
+        return `public class Main {\n${helpers.join('\n')}\n    public static void main(String[] args) {\n        System.out.println(f0(new int[] {1, 2, 3}));\n    }\n}\n`;
+    },
+    cpp: (n, functions) => {
+        const helpers = Array.from({ length: functions }, (_, k) =>
+            `int f${k}(const std::vector<int>& values) {\n    int total = 0;\n    for (int v : values) {\n        total += v * ${k + n};\n    }\n    return total;\n}\n`);
+        return `#include <iostream>\n#include <vector>\n\n${helpers.join('\n')}\nint main() {\n    std::cout << f0({1, 2, 3}) << std::endl;\n    return 0;\n}\n`;
+    },
+    c: (n, functions) => {
+        const helpers = Array.from({ length: functions }, (_, k) =>
+            `static int f${k}(const int *values, int count) {\n    int total = 0;\n    for (int i = 0; i < count; i++) {\n        total += values[i] * ${k + n};\n    }\n    return total;\n}\n`);
+        return `#include <stdio.h>\n\n${helpers.join('\n')}\nint main(void) {\n    int values[] = {1, 2, 3};\n    printf("%d\\n", f0(values, 3));\n    return 0;\n}\n`;
+    }
+};
+
+function breakProgram(language, code, unbalanced) {
+    if (unbalanced && language !== 'python') {
+        return code.slice(0, code.lastIndexOf('}')) + code.slice(code.lastIndexOf('}') + 1);
+    }
+    if (language === 'python') {
+        return code.replace('def f0(values):', 'def f0(values)');
+    }
+    return code.replace('int total = 0;', 'int total = 0').replace('let total = 0;', 'let total = 0 +');
+}
+
+function buildCorpus(options, languages) {
+    const corpus = Object.fromEntries(languages.map(language => [language, []]));
+    if (options.corpus !== 'generated') {
+        for (const test of tests) {
+            const language = { javascript: 'javascript', python: 'python', java: 'java', cpp: 'cpp', c: 'c' }[test.language];
+            if (corpus[language]) {
+                corpus[language].push({ name: test.name, code: test.code, valid: !/Invalid|Unbalanced/.test(test.name) });
+            }
+        }
+    }
+    if (options.corpus !== 'test') {
+        for (const language of languages) {
+            if (!GENERATORS[language]) {
+                continue;
+            }
+            for (let n = 0; n < options.generated; n++) {
+                const code = GENERATORS[language](n, 1 + (n % 8) * 2);
+                const broken = n % 3 === 2;
+                corpus[language].push({
+                    name: `generated ${language} #${n}`,
+                    code: broken ? breakProgram(language, code, n % 6 === 5) : code,
+                    valid: !broken
+                });
+            }
+        }
+    }
+    return corpus;
+}
+
+// A comment that makes the submission's text (and so its cache key) unique
+function uniqueSuffix(language, id) {
+    return language === 'python' ? `\n# loadtest ${id}\n` : `\n// loadtest ${id}\n`;
+}
+
+// Nearest-rank percentile of an ascending array
+function percentile(sorted, p) {
+    if (!sorted.length) {
+        return null;
+    }
+    return sorted[Math.min(sorted.length - 1, Math.ceil(p / 100 * sorted.length) - 1)];
+}
+
+function summarize(samples, seconds) {
+    const latencies = samples.filter(s => s.ok).map(s => s.ms).sort((a, b) => a - b);
+    const round = value => value === null ? null : Math.round(value * 1000) / 1000;
+    const errors = samples.filter(s => !s.ok).length;
+    return {
+        requests: samples.length,
+        ok: latencies.length,
+        errors,
+        throttled: samples.filter(s => s.status === 429).length,
+        mismatches: samples.filter(s => s.ok && s.valid !== s.expected).length,
+        errorRate: samples.length ? errors / samples.length : 0,
+        throughputRps: round(samples.length / seconds),
+        latencyMs: {
+            p50: round(percentile(latencies, 50)),
+            p95: round(percentile(latencies, 95)),
+            p99: round(percentile(latencies, 99)),
+            mean: round(latencies.length ? latencies.reduce((a, b) => a + b, 0) / latencies.length : null),
+            max: round(latencies.length ? latencies[latencies.length - 1] : null)
+        }
+    };
+}
+
+async function send(options, language, entry, id) {
+    const code = options.unique ? entry.code + uniqueSuffix(language, id) : entry.code;
+    const controller = new AbortController();
+    const timer = setTimeout(() => controller.abort(), options.timeout * 1000);
+    try {
+        const response = await fetch(`${options.url}/check-syntax`, {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json', 'x-api-key': options.apiKey },
+            body: JSON.stringify({ language, code }),
+            signal: controller.signal
+        });
+        const body = await response.json().catch(() => ({}));
+        return { status: response.status, ok: response.ok, valid: body.valid };
+    } catch (error) {
+        return { status: 0, ok: false, error: error.name === 'AbortError' ? 'timeout' : error.message };
+    } finally {
+        clearTimeout(timer);
+    }
+}
+
+// With --rps, arrivals follow a fixed schedule and latency counts from the
+// scheduled time, so a stalled server is charged for the requests it kept
+// waiting (no coordinated omission). Without it, each connection sends its
+// next request as soon as the last one is answered.
+async function runLoad(options) {
+    const mix = parseMix(options.mix);
+    if (!mix.length) {
+        throw new Error(`Empty language mix: ${options.mix}`);
+    }
+    const corpus = buildCorpus(options, mix.map(m => m.language));
+    const rand = random(options.seed);
+    const totalWeight = mix.reduce((sum, m) => sum + m.weight, 0);
+    const pick = () => {
+        let r = rand() * totalWeight;
+        const { language } = mix.find(m => (r -= m.weight) < 0) || mix[mix.length - 1];
+        const entries = corpus[language];
+        return { language, entry: entries[Math.floor(rand() * entries.length)] };
+    };
+    for (const { language } of mix) {
+        if (!corpus[language].length) {
+            throw new Error(`No corpus entries for ${language}`);
+        }
+    }
+
+    const samples = [];
+    const errorsSeen = {};
+    const start = performance.now();
+    const measureFrom = start + options.warmup * 1000;
+    const stopAt = options.requests ? Infinity : measureFrom + options.duration * 1000;
+    const interval = options.rps > 0 ? 1000 / options.rps : 0;
+    let issued = 0;
+    let measured = 0;
+    let inFlight = 0;
+    let slotFreed = null;
+
+    const done = () => performance.now() >= stopAt || (options.requests && measured >= options.requests);
+    const pending = new Set();
+    while (!done()) {
+        const scheduled = interval ? start + issued * interval : performance.now();
+        const wait = scheduled - performance.now();
+        if (wait > 0) {
+            await new Promise(resolve => setTimeout(resolve, wait));
+        }
+        while (inFlight >= options.concurrency) {
+            await new Promise(resolve => { slotFreed = resolve; });
+        }
+        if (done()) {
+            break;
+        }
+        const id = issued++;
+        const { language, entry } = pick();
+        const sentAt = interval ? scheduled : performance.now();
+        const counted = sentAt >= measureFrom;
+        if (counted) {
+            measured++;
+        }
+        inFlight++;
+        const request = send(options, language, entry, id).then(result => {
+            if (counted) {
+                samples.push({ language, ms: performance.now() - sentAt, expected: entry.valid, ...result });
+                if (!result.ok) {
+                    const key = result.error || `HTTP ${result.status}`;
+                    errorsSeen[key] = (errorsSeen[key] || 0) + 1;
+                }
+            }
+        }).finally(() => {
+            inFlight--;
+            pending.delete(request);
+            if (slotFreed) {
+                const resolve = slotFreed;
+                slotFreed = null;
+                resolve();
+            }
+        });
+        pending.add(request);
+    }
+    await Promise.all(pending);
+
+    const seconds = Math.max(1e-9, (performance.now() - Math.max(start, measureFrom)) / 1000);
+    const languages = {};
+    for (const { language } of mix) {
+        languages[language] = summarize(samples.filter(s => s.language === language), seconds);
+    }
+    return {
+        durationSeconds: Math.round(seconds * 1000) / 1000,
+        corpusSize: Object.fromEntries(Object.entries(corpus).map(([language, entries]) => [language, entries.length])),
+        total: summarize(samples, seconds),
+        languages,
+        errors: errorsSeen
+    };
+}
+
+// Runs stack_bench --json, building it from stack_bench.cpp first when the
+// binary does not exist
+function runStackBench(options) {
+    let binary = options.stackBench;
+    if (!fs.existsSync(binary)) {
+        binary = path.join(os.tmpdir(), `stack_bench_${process.pid}`);
+        console.error(`Building ${binary} from stack_bench.cpp...`);
+        execFileSync('g++', ['-std=c++17', '-O2', '-pthread', path.join(__dirname, 'stack_bench.cpp'), '-latomic', '-o', binary], { stdio: 'inherit' });
+    }
+    const args = ['--json', '--min-time', String(options.stackBenchMinTime)];
+    if (options.stackBenchFilter) {
+        args.push('--filter', options.stackBenchFilter);
+    }
+    const output = execFileSync(binary, args, { encoding: 'utf8', maxBuffer: 16 * 1024 * 1024 });
+    return JSON.parse(output);
+}
+
+// Every way this report is worse than the baseline by more than the tolerance
+function findRegressions(report, baseline, tolerance) {
+    const regressions = [];
+    const slower = (what, now, before) => {
+        if (now !== null && before && now > before * (1 + tolerance)) {
+            regressions.push({ metric: what, baseline: before, current: now });
+        }
+    };
+    for (const [language, current] of Object.entries((report.load && report.load.languages) || {})) {
+        const before = baseline.load && baseline.load.languages && baseline.load.languages[language];
+        if (!before) {
+            continue;
+        }
+        for (const p of ['p50', 'p95', 'p99']) {
+            slower(`${language} latency ${p} (ms)`, current.latencyMs[p], before.latencyMs[p]);
+        }
+        if (current.throughputRps < before.throughputRps * (1 - tolerance)) {
+            regressions.push({ metric: `${language} throughput (rps)`, baseline: before.throughputRps, current: current.throughputRps });
+        }
+        if (current.errorRate > before.errorRate + 0.01) {
+            regressions.push({ metric: `${language} error rate`, baseline: before.errorRate, current: current.errorRate });
+        }
+        if (current.mismatches > before.mismatches) {
+            regressions.push({ metric: `${language} wrong verdicts`, baseline: before.mismatches, current: current.mismatches });
+        }
+    }
+    const benchBefore = new Map((baseline.stack || []).map(result => [result.name, result]));
+    for (const result of report.stack || []) {
+        const before = benchBefore.get(result.name);
+        if (before) {
+            slower(`stack ${result.name} (ns/op)`, result.ns_per_op, before.ns_per_op);
+        }
+    }
+    return regressions;
+}
+
+function printSummary(report) {
+    const lines = [];
+    if (report.load) {
+        const row = (name, s) => [
+            name.padEnd(12), String(s.requests).padStart(8), String(s.throughputRps).padStart(9),
+            String(s.latencyMs.p50).padStart(9), String(s.latencyMs.p95).padStart(9), String(s.latencyMs.p99).padStart(9),
+            `${(s.errorRate * 100).toFixed(2)}%`.padStart(8), String(s.mismatches).padStart(6)
+        ].join(' ');
+        lines.push(['language'.padEnd(12), 'requests'.padStart(8), 'rps'.padStart(9), 'p50 ms'.padStart(9),
+            'p95 ms'.padStart(9), 'p99 ms'.padStart(9), 'errors'.padStart(8), 'wrong'.padStart(6)].join(' '));
+        for (const [language, summary] of Object.entries(report.load.languages)) {
+            lines.push(row(language, summary));
+        }
+        lines.push(row('total', report.load.total));
+        for (const [error, count] of Object.entries(report.load.errors)) {
+            lines.push(`  ${count} x ${error}`);
+        }
+    }
+    if (report.stack) {
+        lines.push(`stack_bench: ${report.stack.length} benchmarks`);
+    }
+    for (const regression of report.regressions || []) {
+        lines.push(`REGRESSION ${regression.metric}: ${regression.baseline} -> ${regression.current}`);
+    }
+    console.error(lines.join('\n'));
+}
+
+async function main() {
+    const options = parseArgs(process.argv.slice(2));
+    const report = {
+        startedAt: new Date().toISOString(),
+        config: { ...options, apiKey: undefined }
+    };
+    if (options.requests !== 0) {
+        report.load = await runLoad(options);
+    }
+    if (options.stackBench) {
+        report.stack = runStackBench(options);
+    }
+    if (options.baseline) {
+        report.regressions = findRegressions(report, JSON.parse(fs.readFileSync(options.baseline, 'utf8')), options.tolerance);
+    }
+    printSummary(report);
+    process.stdout.write(JSON.stringify(report, null, 2) + '\n');
+    if (report.regressions && report.regressions.length) {
+        process.exitCode = 1;
+    }
+}
+
+if (require.main === module) {
+    main().catch(error => {
+        console.error('Load test failed:', error.message);
+        process.exit(2);
+    });
+}
+
+module.exports = { buildCorpus, percentile, summarize, findRegressions };
@@ -1,6 +1,21 @@
 #include <iostream>
 #include "Stack.hpp"
 
+// Evaluated at compile time below to check that FixedStack is constexpr.
+constexpr std::size_t maxNestingDepth(const char* text) {
+    FixedStack<char, 16> open;
+    std::size_t depth = 0;
+    for (; *text; ++text) {
+        if (*text == '(') {
+            open.push(*text);
+            depth = open.size() > depth ? open.size() : depth;
+        } else if (*text == ')') {
+            open.pop();
+        }
+    }
+    return depth;
+}
+
 int main() {
     try {
         std::cout << "\nTesting Integer Stack:" << std::endl;
@@ -13,8 +28,8 @@ int main() {
         
         // Pop and print integers
         std::cout << "Popping integers: ";
-        while (!intStack.isEmpty()) {
-            std::cout << intStack.pop() << " ";
+        while (std::optional<int> value = intStack.tryPop()) {
+            std::cout << *value << " ";
         }
         std::cout << std::endl;
 
@@ -40,6 +55,55 @@ int main() {
         }
         std::cout << std::endl;
 
+        std::cout << "\nTesting Small-Buffer Stack:" << std::endl;
+        SmallStack<char, 16> brackets;
+        const char* line = "{ f(a[i], (b)) }";
+        for (const char* c = line; *c; ++c) {
+            if (*c == '{' || *c == '(' || *c == '[') {
+                brackets.push(*c);
+            } else if (*c == '}' || *c == ')' || *c == ']') {
+                brackets.pop();
+            }
+        }
+        std::cout << "Balanced: " << (brackets.isEmpty() ? "yes" : "no")
+                  << ", capacity still inline: " << brackets.capacity() << std::endl;
+
+        for (int i = 0; i < 20; i++) {
+            brackets.push('(');
+        }
+        std::cout << "Capacity after spilling 20 elements to the heap: " << brackets.capacity() << std::endl;
+        brackets.clear();
+        brackets.shrinkToFit();
+        std::cout << "Capacity after clear() and shrinkToFit(): " << brackets.capacity() << std::endl;
+
+        std::cout << "\nTesting Fixed-Capacity Stack:" << std::endl;
+        static_assert(maxNestingDepth("(()(()))") == 3, "constexpr FixedStack evaluation");
+        std::cout << "Compile-time nesting depth of \"(()(()))\": " << maxNestingDepth("(()(()))") << std::endl;
+
+        FixedStack<int, 2> fixedStack;
+        fixedStack.push(1);
+        fixedStack.push(2);
+        try {
+            fixedStack.push(3);
+        } catch (const std::overflow_error& e) {
+            std::cout << "Expected error caught: " << e.what() << std::endl;
+        }
+
+        std::cout << "Overflow reported without throwing: "
+                  << (fixedStack.tryPush(3) ? "no" : "yes") << std::endl;
+
+        // Unchecked calls after an explicit capacity check
+        Stack<int> reserved;
+        reserved.reserve(4);
+        for (int i = 0; i < 4; i++) {
+            reserved.pushUnchecked(i * i);
+        }
+        std::cout << "Unchecked pops: ";
+        while (!reserved.isEmpty()) {
+            std::cout << reserved.popUnchecked() << " ";
+        }
+        std::cout << std::endl;
+
     } catch (const std::exception& e) {
         std::cerr << "Unexpected error: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,677 @@
+// Native pre-checker for C and C++ submissions, loaded by server.js as
+// build/Release/precheck.node (see binding.gyp). It lexes just enough of the
+// source to find unbalanced (), [] and {}, unterminated string, character
+// and raw string literals and unterminated block comments, so that code
+// which cannot compile is rejected before a compiler worker is scheduled.
+//
+// The verdict must never be stricter than the compiler's: anything the scan
+// cannot reason about (conditional compilation, digraphs, trigraphs, macros
+// whose bodies are unbalanced, function-like macros, whose arguments need not
+// balance, literals inside other directives) makes it answer "unsure", and
+// the submission goes to the compiler as before.
+
+#include <node_api.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "Stack.hpp"
+
+namespace {
+
+// Offset of the first byte at or after `from` that is one of Chars, or
+// `end`. Sixteen bytes are compared per step where SSE2 or NEON is
+// available, so comments, literals and ordinary code are skipped in bulk.
+template <char... Chars>
+std::size_t findAny(const char* text, std::size_t from, std::size_t end) {
+#if defined(__SSE2__)
+    while (from + 16 <= end) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + from));
+        __m128i hits = _mm_setzero_si128();
+        ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(Chars)))), ...);
+        const int mask = _mm_movemask_epi8(hits);
+        if (mask) {
+            return from + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+        from += 16;
+    }
+#elif defined(__ARM_NEON)
+    while (from + 16 <= end) {
+        const uint8x16_t block = vld1q_u8(reinterpret_cast<const std::uint8_t*>(text + from));
+        uint8x16_t hits = vdupq_n_u8(0);
+        ((hits = vorrq_u8(hits, vceqq_u8(block, vdupq_n_u8(static_cast<std::uint8_t>(Chars))))), ...);
+        // Four mask bits per byte
+        const std::uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+        if (mask) {
+            return from + static_cast<std::size_t>(__builtin_ctzll(mask) >> 2);
+        }
+        from += 16;
+    }
+#endif
+    for (; from < end; ++from) {
+        if (((text[from] == Chars) || ...)) {
+            return from;
+        }
+    }
+    return end;
+}
+
+bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+char closerFor(char opener) {
+    return opener == '(' ? ')' : opener == '[' ? ']' : '}';
+}
+
+char openerFor(char closer) {
+    return closer == ')' ? '(' : closer == ']' ? '[' : '{';
+}
+
+enum class Dialect { C, Cpp };
+
+enum class Outcome { Clean, Broken, Unsure };
+
+// Where and why the code is broken, as byte offsets. The note, if any,
+// points at the delimiter the error refers back to.
+struct Finding {
+    std::size_t offset = 0;
+    std::string message;
+    bool hasNote = false;
+    std::size_t noteOffset = 0;
+    std::string note;
+};
+
+// Delimiters is the stack of unclosed delimiter offsets: an ArenaStack for
+// a single check, or one stack of a batch's MultiStack.
+template <typename Delimiters>
+class Scanner {
+public:
+    Scanner(const char* text, std::size_t size, Dialect dialect, Delimiters& open)
+        : text(text), size(size), dialect(dialect), pos(0), open(open) {}
+
+    Outcome run(Finding& finding) {
+        // Under the ISO modes trigraphs are replaced before anything else,
+        // inside literals and comments too: ??< is '{' and ??/ a backslash
+        // that can continue a // comment or escape a closing quote
+        if (std::string_view(text, size).find("??") != std::string_view::npos) {
+            return Outcome::Unsure;
+        }
+        while (true) {
+            pos = findAny<'(', ')', '[', ']', '{', '}', '"', '\'', '/', '#', '<', '%', ':'>(text, pos, size);
+            if (pos == size) {
+                break;
+            }
+            Outcome outcome = Outcome::Clean;
+            const char c = text[pos];
+            switch (c) {
+                case '(':
+                case '[':
+                case '{':
+                    // A stack that cannot take another (a batch's, at its
+                    // depth) leaves the verdict to someone else
+                    outcome = open.tryPush(static_cast<std::uint32_t>(pos++)) ? Outcome::Clean : Outcome::Unsure;
+                    break;
+                case ')':
+                case ']':
+                case '}':
+                    outcome = close(c, finding);
+                    break;
+                case '"':
+                case '\'':
+                    outcome = literal(false, finding);
+                    break;
+                case '/':
+                    outcome = comment(finding);
+                    break;
+                case '#':
+                    outcome = atLineStart(pos) ? directive(finding) : Outcome::Unsure;
+                    break;
+                default:
+                    outcome = digraph() ? Outcome::Unsure : Outcome::Clean;
+                    ++pos;
+                    break;
+            }
+            if (outcome != Outcome::Clean) {
+                return outcome;
+            }
+        }
+
+        if (!open.isEmpty()) {
+            if (functionMacro) {
+                return Outcome::Unsure;
+            }
+            const std::size_t opener = open.peek();
+            std::size_t end = size;
+            while (end > 0 && (text[end - 1] == ' ' || text[end - 1] == '\t' || text[end - 1] == '\r' || text[end - 1] == '\n')) {
+                --end;
+            }
+            return broken(finding, end, std::string("expected '") + closerFor(text[opener]) + "' at end of input", opener);
+        }
+        return Outcome::Clean;
+    }
+
+private:
+    const char* text;
+    std::size_t size;
+    Dialect dialect;
+    std::size_t pos;
+    Delimiters& open; // offsets of the unclosed delimiters
+    // Once a function-like macro is defined, a mismatch may be one of its
+    // arguments, as in ID({), which the compiler accepts
+    bool functionMacro = false;
+
+    Outcome broken(Finding& finding, std::size_t offset, std::string message, std::size_t noteOffset = SIZE_MAX) {
+        finding.offset = offset;
+        finding.message = std::move(message);
+        if (noteOffset != SIZE_MAX) {
+            finding.hasNote = true;
+            finding.noteOffset = noteOffset;
+            finding.note = std::string("to match this '") + text[noteOffset] + "'";
+        }
+        return Outcome::Broken;
+    }
+
+    char at(std::size_t i) const {
+        return i < size ? text[i] : '\0';
+    }
+
+    Outcome close(char closer, Finding& finding) {
+        if (functionMacro && (open.isEmpty() || closerFor(text[open.peek()]) != closer)) {
+            return Outcome::Unsure;
+        }
+        if (open.isEmpty()) {
+            return broken(finding, pos, std::string("'") + closer + "' without a matching '" + openerFor(closer) + "'");
+        }
+        const std::size_t opener = open.peek();
+        const char expected = closerFor(text[opener]);
+        if (expected != closer) {
+            return broken(finding, pos, std::string("expected '") + expected + "' before '" + closer + "' token", opener);
+        }
+        open.popUnchecked();
+        ++pos;
+        return Outcome::Clean;
+    }
+
+    // Digraphs spell brackets and braces another way; rather than track
+    // them the scan gives up. In C++ "<::" is '<' '::' unless a ':' or '>'
+    // follows it.
+    bool digraph() const {
+        const char c = text[pos];
+        const char next = at(pos + 1);
+        if (c == '<') {
+            if (next == '%') {
+                return true;
+            }
+            if (next != ':') {
+                return false;
+            }
+            return dialect == Dialect::C || at(pos + 2) != ':' || at(pos + 3) == ':' || at(pos + 3) == '>';
+        }
+        if (c == '%') {
+            return next == '>' || next == ':';
+        }
+        return next == '>'; // ":>"
+    }
+
+    // Whether only spaces and tabs precede `i` on its physical line, and
+    // that line does not continue the one before it
+    bool atLineStart(std::size_t i) const {
+        while (i > 0 && (text[i - 1] == ' ' || text[i - 1] == '\t')) {
+            --i;
+        }
+        if (i == 0) {
+            return true;
+        }
+        if (text[i - 1] != '\n') {
+            return false;
+        }
+        std::size_t j = i - 1;
+        if (j > 0 && text[j - 1] == '\r') {
+            --j;
+        }
+        return j == 0 || text[j - 1] != '\\';
+    }
+
+    // Offset of the newline that ends the logical line containing `from`,
+    // following backslash continuations, or `size`
+    std::size_t endOfLogicalLine(std::size_t from) const {
+        while (true) {
+            const std::size_t newline = findAny<'\n'>(text, from, size);
+            if (newline == size) {
+                return size;
+            }
+            std::size_t j = newline;
+            while (j > 0 && (text[j - 1] == ' ' || text[j - 1] == '\t' || text[j - 1] == '\r')) {
+                --j;
+            }
+            if (j == 0 || text[j - 1] != '\\') {
+                return newline;
+            }
+            from = newline + 1;
+        }
+    }
+
+    // `pos` is at a '/'
+    Outcome comment(Finding& finding) {
+        const char next = at(pos + 1);
+        if (next == '/') {
+            pos = endOfLogicalLine(pos + 2);
+            return Outcome::Clean;
+        }
+        if (next != '*') {
+            ++pos;
+            return Outcome::Clean;
+        }
+        const std::size_t start = pos;
+        std::size_t i = pos + 2;
+        while (true) {
+            i = findAny<'*'>(text, i, size);
+            if (i == size) {
+                return broken(finding, start, "unterminated comment");
+            }
+            if (at(i + 1) == '/') {
+                pos = i + 2;
+                return Outcome::Clean;
+            }
+            ++i;
+        }
+    }
+
+    // Start of the identifier or number that ends right before `i`
+    std::size_t tokenStart(std::size_t i, bool numberChars) const {
+        while (i > 0 && (isIdentifierChar(text[i - 1]) || (numberChars && (text[i - 1] == '.' || text[i - 1] == '\'')))) {
+            --i;
+        }
+        return i;
+    }
+
+    bool isDigitSeparator() const {
+        const std::size_t start = tokenStart(pos, true);
+        if (start == pos) {
+            return false;
+        }
+        return isDigit(text[start]) || (text[start] == '.' && isDigit(at(start + 1)));
+    }
+
+    bool isRawStringPrefix(std::size_t start) const {
+        const std::string_view prefix(text + start, pos - start);
+        return prefix == "R" || prefix == "LR" || prefix == "uR" || prefix == "UR" || prefix == "u8R";
+    }
+
+    // `pos` is at a quote. Inside a directive an unterminated literal is
+    // not necessarily an error (#error can't, #include <it's.h>), so there
+    // the scan is only unsure.
+    Outcome literal(bool inDirective, Finding& finding) {
+        const char quote = text[pos];
+        if (quote == '\'' && isDigitSeparator()) {
+            ++pos;
+            return Outcome::Clean;
+        }
+        if (quote == '"') {
+            const std::size_t start = tokenStart(pos, false);
+            if (start < pos && isRawStringPrefix(start)) {
+                return rawString(start, finding);
+            }
+        }
+
+        const std::size_t start = pos;
+        std::size_t i = pos + 1;
+        while (true) {
+            i = quote == '"' ? findAny<'"', '\\', '\n'>(text, i, size) : findAny<'\'', '\\', '\n'>(text, i, size);
+            if (i == size || text[i] == '\n') {
+                if (inDirective) {
+                    return Outcome::Unsure;
+                }
+                return broken(finding, start, std::string("missing terminating ") + quote + " character");
+            }
+            if (text[i] == '\\') {
+                i += at(i + 1) == '\r' && at(i + 2) == '\n' ? 3 : 2;
+                continue;
+            }
+            if (quote == '\'' && i == start + 1 && !inDirective) {
+                return broken(finding, start, "empty character constant");
+            }
+            pos = i + 1;
+            return Outcome::Clean;
+        }
+    }
+
+    // `pos` is at the opening quote of R"delimiter( ... )delimiter"
+    Outcome rawString(std::size_t start, Finding& finding) {
+        std::size_t i = pos + 1;
+        while (i < size && i - pos - 1 <= 16 && text[i] != '(') {
+            const char c = text[i];
+            if (c == ')' || c == '\\' || c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\n' || c == '\r' || c == '"') {
+                return Outcome::Unsure;
+            }
+            ++i;
+        }
+        if (i >= size || text[i] != '(') {
+            return Outcome::Unsure;
+        }
+        std::string terminator(")");
+        terminator.append(text + pos + 1, i - pos - 1);
+        terminator.push_back('"');
+        const std::size_t end = std::string_view(text, size).find(terminator, i + 1);
+        if (end == std::string_view::npos) {
+            // C has no raw strings; there R"..." is an identifier and a string
+            if (dialect == Dialect::C) {
+                return Outcome::Unsure;
+            }
+            return broken(finding, start, "unterminated raw string");
+        }
+        pos = end + terminator.size();
+        return Outcome::Clean;
+    }
+
+    // `pos` is at the '#' of a directive. Its line is lexed for comments and
+    // literals, which may run past it, but its delimiters are not matched
+    // against the code's. Conditional compilation makes the active text
+    // unknowable here, and a #define whose body does not balance on its own
+    // can unbalance every use, so both end the scan.
+    Outcome directive(Finding& finding) {
+        std::size_t i = pos + 1;
+        while (i < size && (text[i] == ' ' || text[i] == '\t')) {
+            ++i;
+        }
+        const std::size_t nameStart = i;
+        while (i < size && isIdentifierChar(text[i])) {
+            ++i;
+        }
+        const std::string_view name(text + nameStart, i - nameStart);
+        if (name == "if" || name == "ifdef" || name == "ifndef" || name == "elif" || name == "else" ||
+            name == "elifdef" || name == "elifndef") {
+            return Outcome::Unsure;
+        }
+        const bool define = name == "define";
+        if (define) {
+            std::size_t j = i;
+            while (j < size && (text[j] == ' ' || text[j] == '\t')) {
+                ++j;
+            }
+            const std::size_t macroStart = j;
+            while (j < size && isIdentifierChar(text[j])) {
+                ++j;
+            }
+            functionMacro = functionMacro || (j > macroStart && at(j) == '(');
+        }
+
+        int balance[3] = {0, 0, 0}; // () [] {}
+        pos = i;
+        while (true) {
+            pos = findAny<'\n', '"', '\'', '/', '(', ')', '[', ']', '{', '}', '\\'>(text, pos, size);
+            if (pos == size || text[pos] == '\n') {
+                break;
+            }
+            Outcome outcome = Outcome::Clean;
+            switch (text[pos]) {
+                case '(': ++balance[0]; ++pos; break;
+                case ')': --balance[0]; ++pos; break;
+                case '[': ++balance[1]; ++pos; break;
+                case ']': --balance[1]; ++pos; break;
+                case '{': ++balance[2]; ++pos; break;
+                case '}': --balance[2]; ++pos; break;
+                case '"':
+                case '\'':
+                    outcome = literal(true, finding);
+                    break;
+                case '/':
+                    if (at(pos + 1) == '/') {
+                        pos = endOfLogicalLine(pos + 2);
+                    } else {
+                        outcome = comment(finding);
+                    }
+                    break;
+                default: // a backslash, perhaps continuing the line
+                    pos = at(pos + 1) == '\r' && at(pos + 2) == '\n' ? pos + 3 : pos + 2;
+                    break;
+            }
+            if (outcome != Outcome::Clean) {
+                return outcome;
+            }
+        }
+        if (define && (balance[0] || balance[1] || balance[2])) {
+            return Outcome::Unsure;
+        }
+        return Outcome::Clean;
+    }
+};
+
+// 1-based line and column of a byte offset. Columns count like gcc's:
+// a tab advances to the next multiple of eight and a multi-byte UTF-8
+// character counts once.
+void locate(const char* text, std::size_t offset, std::uint32_t& line, std::uint32_t& column) {
+    line = 1;
+    std::size_t lineStart = 0;
+    for (std::size_t i = 0; i < offset; ++i) {
+        if (text[i] == '\n') {
+            ++line;
+            lineStart = i + 1;
+        }
+    }
+    column = 1;
+    for (std::size_t i = lineStart; i < offset; ++i) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '\t') {
+            column = ((column - 1) / 8 + 1) * 8 + 1;
+        } else if ((c & 0xC0) != 0x80) {
+            ++column;
+        }
+    }
+}
+
+napi_value location(napi_env env, const char* text, std::size_t offset, const std::string& message) {
+    std::uint32_t line;
+    std::uint32_t column;
+    locate(text, offset, line, column);
+    napi_value result;
+    napi_value value;
+    napi_create_object(env, &result);
+    napi_create_uint32(env, line, &value);
+    napi_set_named_property(env, result, "line", value);
+    napi_create_uint32(env, column, &value);
+    napi_set_named_property(env, result, "column", value);
+    napi_create_string_utf8(env, message.data(), message.size(), &value);
+    napi_set_named_property(env, result, "message", value);
+    return result;
+}
+
+std::string stringArgument(napi_env env, napi_value value, bool& ok) {
+    std::size_t length = 0;
+    ok = napi_get_value_string_utf8(env, value, nullptr, 0, &length) == napi_ok;
+    if (!ok) {
+        return std::string();
+    }
+    std::string result(length, '\0');
+    napi_get_value_string_utf8(env, value, &result[0], length + 1, &length);
+    return result;
+}
+
+// Scratch memory for the bracket stacks. One arena per thread (the main
+// thread and any worker thread that loads the addon), rewound after every
+// call, so a warm arena allocates nothing.
+MonotonicArena& scratchArena() {
+    thread_local MonotonicArena arena;
+    return arena;
+}
+
+// Rewinds the arena when a call ends, however it ends
+struct ScratchScope {
+    MonotonicArena& arena;
+
+    ~ScratchScope() {
+        arena.reset();
+    }
+};
+
+// Depth of each submission's stack in a batch. Deeper nesting is rare, and
+// such a submission is scanned again on its own, growable stack.
+constexpr std::size_t BATCH_STACK_DEPTH = 64;
+
+typedef ArenaStack<std::uint32_t, 64> SingleStack;
+typedef MultiStack<std::uint32_t, ArenaAllocator<std::uint32_t> > BatchStacks;
+
+bool dialectArgument(const std::string& language, Dialect& dialect) {
+    if (language != "c" && language != "cpp") {
+        return false;
+    }
+    dialect = language == "c" ? Dialect::C : Dialect::Cpp;
+    return true;
+}
+
+Outcome scanAlone(const std::string& code, Dialect dialect, MonotonicArena& arena, Finding& finding) {
+    SingleStack open(arena);
+    Scanner<SingleStack> scanner(code.data(), code.size(), dialect, open);
+    return scanner.run(finding);
+}
+
+// The JavaScript value of a scan: null unless the code is broken
+napi_value findingValue(napi_env env, const std::string& code, Outcome outcome, const Finding& finding) {
+    napi_value result;
+    if (outcome != Outcome::Broken) {
+        napi_get_null(env, &result);
+        return result;
+    }
+    result = location(env, code.data(), finding.offset, finding.message);
+    if (finding.hasNote) {
+        napi_set_named_property(env, result, "note", location(env, code.data(), finding.noteOffset, finding.note));
+    }
+    return result;
+}
+
+// precheck(code, language) with language 'c' or 'cpp'. Returns null when
+// the code may well compile, or { line, column, message, note? } where
+// note is { line, column, message } for the delimiter an error refers to.
+napi_value precheck(napi_env env, napi_callback_info info) {
+    std::size_t argc = 2;
+    napi_value argv[2];
+    napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+    if (argc < 2) {
+        napi_throw_type_error(env, nullptr, "precheck(code, language) needs two arguments");
+        return nullptr;
+    }
+
+    bool ok;
+    const std::string code = stringArgument(env, argv[0], ok);
+    if (!ok) {
+        napi_throw_type_error(env, nullptr, "code must be a string");
+        return nullptr;
+    }
+    Dialect dialect;
+    if (!dialectArgument(stringArgument(env, argv[1], ok), dialect) || !ok) {
+        napi_throw_type_error(env, nullptr, "language must be 'c' or 'cpp'");
+        return nullptr;
+    }
+
+    if (code.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        return findingValue(env, code, Outcome::Unsure, Finding());
+    }
+    try {
+        ScratchScope scratch = { scratchArena() };
+        Finding finding;
+        const Outcome outcome = scanAlone(code, dialect, scratch.arena, finding);
+        return findingValue(env, code, outcome, finding);
+    } catch (const std::exception& e) {
+        napi_throw_error(env, nullptr, e.what());
+        return nullptr;
+    }
+}
+
+// One submission of a batch, scanned on stack i of `stacks`
+napi_value precheckElement(napi_env env, napi_value codes, std::uint32_t i, Dialect dialect,
+                           BatchStacks& stacks, MonotonicArena& arena) {
+    napi_value element;
+    bool ok;
+    napi_get_element(env, codes, i, &element);
+    const std::string code = stringArgument(env, element, ok);
+    if (!ok) {
+        napi_throw_type_error(env, nullptr, "codes must be strings");
+        return nullptr;
+    }
+    Finding finding;
+    Outcome outcome = Outcome::Unsure;
+    if (code.size() < std::numeric_limits<std::uint32_t>::max()) {
+        BatchStacks::StackView open = stacks[i];
+        Scanner<BatchStacks::StackView> scanner(code.data(), code.size(), dialect, open);
+        outcome = scanner.run(finding);
+        if (outcome == Outcome::Unsure && open.size() == open.capacity()) {
+            finding = Finding();
+            outcome = scanAlone(code, dialect, arena, finding);
+        }
+    }
+    return findingValue(env, code, outcome, finding);
+}
+
+// precheckBatch(codes, language): precheck() over an array of submissions
+// in one language, returning an array of its results. All the
+// submissions' bracket stacks share one MultiStack drawn from the scratch
+// arena; one nested deeper than BATCH_STACK_DEPTH is scanned again alone.
+napi_value precheckBatch(napi_env env, napi_callback_info info) {
+    std::size_t argc = 2;
+    napi_value argv[2];
+    napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+    bool isArray = false;
+    std::uint32_t count = 0;
+    if (argc < 2 || napi_is_array(env, argv[0], &isArray) != napi_ok || !isArray ||
+        napi_get_array_length(env, argv[0], &count) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "precheckBatch(codes, language) needs an array of codes");
+        return nullptr;
+    }
+    bool ok;
+    Dialect dialect;
+    if (!dialectArgument(stringArgument(env, argv[1], ok), dialect) || !ok) {
+        napi_throw_type_error(env, nullptr, "language must be 'c' or 'cpp'");
+        return nullptr;
+    }
+
+    napi_value results;
+    napi_create_array_with_length(env, count, &results);
+    try {
+        ScratchScope scratch = { scratchArena() };
+        BatchStacks stacks(count, BATCH_STACK_DEPTH, scratch.arena);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            // A scope per element, so a large batch does not pile up handles
+            napi_handle_scope scope;
+            napi_open_handle_scope(env, &scope);
+            napi_value result = precheckElement(env, argv[0], i, dialect, stacks, scratch.arena);
+            if (result) {
+                napi_set_element(env, results, i, result);
+            }
+            napi_close_handle_scope(env, scope);
+            if (!result) {
+                return nullptr;
+            }
+        }
+        return results;
+    } catch (const std::exception& e) {
+        napi_throw_error(env, nullptr, e.what());
+        return nullptr;
+    }
+}
+
+} // namespace
+
+NAPI_MODULE_INIT() {
+    napi_value fn;
+    napi_create_function(env, "precheck", NAPI_AUTO_LENGTH, precheck, nullptr, &fn);
+    napi_set_named_property(env, exports, "precheck", fn);
+    napi_create_function(env, "precheckBatch", NAPI_AUTO_LENGTH, precheckBatch, nullptr, &fn);
+    napi_set_named_property(env, exports, "precheckBatch", fn);
+    return exports;
+}
@@ -0,0 +1,45 @@
+"""Long-lived Python syntax checker driven by server.js through python-shell.
+
+Each request is one JSON line on stdin, {"id": n, "code": "..."}, and each
+reply is one JSON line on stdout, {"id": n, "valid": true} or
+{"id": n, "valid": false, "line": ..., "column": ..., "type": ...,
+"message": ..., "traceback": ...}. Requests are answered in order, so the
+server may pipeline several per worker.
+"""
+
+import json
+import sys
+import traceback
+
+
+def check(code):
+    try:
+        compile(code, '<stdin>', 'exec', dont_inherit=True)
+        return {'valid': True}
+    except (SyntaxError, ValueError, RecursionError, MemoryError) as e:
+        # The same text `python3 -m py_compile` prints, without our frames
+        reply = {
+            'valid': False,
+            'type': type(e).__name__,
+            'message': getattr(e, 'msg', None) or str(e),
+            'traceback': ''.join(traceback.format_exception(type(e), e, None)),
+        }
+        if isinstance(e, SyntaxError):
+            reply['line'] = e.lineno
+            reply['column'] = e.offset
+        return reply
+
+
+def main():
+    for line in sys.stdin:
+        if not line.strip():
+            continue
+        request = json.loads(line)
+        reply = check(request['code'])
+        reply['id'] = request['id']
+        sys.stdout.write(json.dumps(reply) + '\n')
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -1,12 +1,15 @@
+const cluster = require('cluster');
 const express = require('express');
 const cors = require('cors');
-const { parse: babelParse } = require('@babel/parser');
+const crypto = require('crypto');
 const { PythonShell } = require('python-shell');
 const fs = require('fs').promises;
+const os = require('os');
 const path = require('path');
-const { exec } = require('child_process');
-const util = require('util');
-const execAsync = util.promisify(exec);
+const { spawn } = require('child_process');
+const { Worker } = require('worker_threads');
+const { AsyncLocalStorage } = require('async_hooks');
+const { performance } = require('perf_hooks');
 require('dotenv').config();
 
 const app = express();
@@ -15,12 +18,48 @@ const TEMP_DIR = process.env.TEMP_DIR || './temp';
 const DOCKER_JAVA_IMAGE = process.env.DOCKER_JAVA_IMAGE || 'openjdk:11';
 const DOCKER_PYTHON_IMAGE = process.env.DOCKER_PYTHON_IMAGE || 'python:3.9-slim';
 const DOCKER_CPP_IMAGE = process.env.DOCKER_CPP_IMAGE || 'gcc:latest';
-const DOCKER_C_IMAGE = process.env.DOCKER_C_IMAGE || 'gcc:latest';
 const MAX_CODE_SIZE = parseInt(process.env.MAX_CODE_SIZE || '1048576', 10);
-const CLEANUP_INTERVAL = parseInt(process.env.CLEANUP_INTERVAL || '3600000', 10);
 const DEBUG = process.env.DEBUG === 'true';
 const EXECUTION_TIMEOUT = parseInt(process.env.EXECUTION_TIMEOUT || '10000', 10);
 const COMPILE_TIMEOUT = parseInt(process.env.COMPILE_TIMEOUT || '15000', 10);
+const COMPILER_SANDBOX = process.env.COMPILER_SANDBOX || 'docker'; // 'docker' or 'none' (run on the host)
+const COMPILER_POOL_SIZE = parseInt(process.env.COMPILER_POOL_SIZE || String(os.cpus().length), 10);
+const COMPILER_WORKER_MAX_JOBS = parseInt(process.env.COMPILER_WORKER_MAX_JOBS || '200', 10);
+const COMPILER_WORKER_MEMORY = process.env.COMPILER_WORKER_MEMORY || '512m';
+const COMPILER_WORKER_CPUS = process.env.COMPILER_WORKER_CPUS || '1';
+const CPP_PCH_DIR = process.env.CPP_PCH_DIR || ''; // e.g. /opt/prelude in the cpp-syntax-checker image
+const CPP_STANDARD_DETECTION = process.env.CPP_STANDARD_DETECTION || 'single'; // 'single' or 'parallel'
+const EXECUTION_MEMORY_LIMIT_MB = parseInt(process.env.EXECUTION_MEMORY_LIMIT_MB || '256', 10);
+const EXECUTION_FILE_SIZE_LIMIT_MB = parseInt(process.env.EXECUTION_FILE_SIZE_LIMIT_MB || '16', 10);
+const EXECUTION_OUTPUT_LIMIT = parseInt(process.env.EXECUTION_OUTPUT_LIMIT || '1048576', 10); // stdout + stderr bytes
+const EXECUTION_CPUS = process.env.EXECUTION_CPUS || '1'; // per one-shot execution container
+const MAX_BATCH_SIZE = parseInt(process.env.MAX_BATCH_SIZE || '16777216', 10); // request body bytes
+const BATCH_MAX_SUBMISSIONS = parseInt(process.env.BATCH_MAX_SUBMISSIONS || '1000', 10);
+const BATCH_CONCURRENCY = parseInt(process.env.BATCH_CONCURRENCY || String(COMPILER_POOL_SIZE), 10);
+const BATCH_TU_PER_COMPILE = parseInt(process.env.BATCH_TU_PER_COMPILE || '16', 10);
+const SCHEDULER_CAPACITY = parseInt(process.env.SCHEDULER_CAPACITY || String(os.cpus().length * 4), 10); // cost units
+const SCHEDULER_QUEUE_LIMIT = parseInt(process.env.SCHEDULER_QUEUE_LIMIT || '100', 10); // waiting jobs per language
+// Relative cost of one job, from measured check + run times
+const SCHEDULER_WEIGHTS = process.env.SCHEDULER_WEIGHTS || 'javascript=1,python=2,c=3,cpp=4,java=8';
+const JS_WORKER_POOL_SIZE = parseInt(process.env.JS_WORKER_POOL_SIZE || String(os.cpus().length), 10);
+const JS_PARSE_TIMEOUT = parseInt(process.env.JS_PARSE_TIMEOUT || '5000', 10);
+const PYTHON_WORKER_POOL_SIZE = parseInt(process.env.PYTHON_WORKER_POOL_SIZE || String(Math.max(1, Math.floor(os.cpus().length / 2))), 10);
+const JAVA_SERVICE_POOL_SIZE = parseInt(process.env.JAVA_SERVICE_POOL_SIZE || '2', 10);
+const CPP_DIAGNOSTICS_FORMAT = process.env.CPP_DIAGNOSTICS_FORMAT || 'auto'; // 'json', 'text' or 'auto'
+const MAX_DIAGNOSTICS = parseInt(process.env.MAX_DIAGNOSTICS || '50', 10);
+// Bytes of diagnostics a compiler may write; they are streamed, not buffered
+const COMPILER_OUTPUT_LIMIT = parseInt(process.env.COMPILER_OUTPUT_LIMIT || String(32 * 1024 * 1024), 10);
+const RESULT_CACHE_SIZE = parseInt(process.env.RESULT_CACHE_SIZE || '10000', 10);
+const RESULT_CACHE_DIR = process.env.RESULT_CACHE_DIR || ''; // shared tier, e.g. a volume mounted by every instance
+const SESSION_TTL = parseInt(process.env.SESSION_TTL || '600000', 10); // ms without a request
+const SESSION_LIMIT = parseInt(process.env.SESSION_LIMIT || '1000', 10);
+const WORKSPACE_DIR = process.env.WORKSPACE_DIR || ''; // default: a tmpfs under /dev/shm if writable, else TEMP_DIR/slots
+const WORKSPACE_SLOTS = parseInt(process.env.WORKSPACE_SLOTS || String(SCHEDULER_CAPACITY * 2), 10);
+// HTTP worker processes; 'auto' for one per core, 1 for no cluster
+const CLUSTER_WORKERS = process.env.CLUSTER_WORKERS === 'auto' ? os.cpus().length : parseInt(process.env.CLUSTER_WORKERS || '1', 10);
+const CLUSTERED = CLUSTER_WORKERS > 1;
+const IS_PRIMARY = CLUSTERED && cluster.isPrimary;
+const IS_WORKER = CLUSTERED && cluster.isWorker;
 
 // Debug logging function
 const debugLog = (...args) => {
@@ -29,59 +68,1466 @@ const debugLog = (...args) => {
     }
 };
 
-// Execute command with timeout
-async function executeWithTimeout(cmd, timeout) {
+// Run a program directly (no shell), streaming its output. Resolves with
+// { stdout, stderr } and rejects like a promisified exec does, with error.stdout and
+// error.stderr attached and 'Command timed out' as the message (and
+// error.timedOut set) when the timeout fires. `input`, when given, is
+// written to the program's stdin, which is then closed; otherwise stdin is
+// empty. onStdout/onStderr receive output as it arrives. A program that
+// writes more than `maxOutput` bytes (stdout and stderr together) is killed
+// and the promise rejects with error.outputLimitExceeded, so output is never
+// buffered without bound; aborting `signal` kills it too (error.aborted).
+// With `buffer: false`, output handed to a listener is not also collected
+// into the result (or error.stdout and error.stderr).
+function runFile(file, args, { timeout = 0, input, onStdout, onStderr, maxOutput = 1024 * 1024, signal, buffer = true } = {}) {
     return new Promise((resolve, reject) => {
-        const process = exec(cmd, { timeout }, (error, stdout, stderr) => {
-            if (error) {
-                if (error.signal === 'SIGTERM') {
-                    reject(new Error('Command timed out'));
-                } else {
-                    reject(error);
+        const child = spawn(file, args, { stdio: [input === undefined ? 'ignore' : 'pipe', 'pipe', 'pipe'] });
+        const output = { stdout: '', stderr: '' };
+        let written = 0;
+        let stopped = null;
+        const stop = reason => {
+            if (!stopped) {
+                stopped = reason;
+                child.kill('SIGKILL');
+            }
+        };
+        const timer = timeout ? setTimeout(() => stop('timedOut'), timeout) : null;
+        const onAbort = () => stop('aborted');
+        if (signal) {
+            if (signal.aborted) {
+                onAbort();
+            }
+            signal.addEventListener('abort', onAbort);
+        }
+
+        const collect = (name, listener) => {
+            child[name].setEncoding('utf8');
+            child[name].on('data', chunk => {
+                if (stopped) {
+                    return;
+                }
+                const bytes = Buffer.byteLength(chunk);
+                if (written + bytes > maxOutput) {
+                    chunk = Buffer.from(chunk).subarray(0, maxOutput - written).toString('utf8').replace(/\uFFFD$/, '');
+                    stop('outputLimitExceeded');
+                }
+                written += bytes;
+                if (buffer || !listener) {
+                    output[name] += chunk;
+                }
+                if (listener && chunk) {
+                    listener(chunk);
+                }
+            });
+        };
+        collect('stdout', onStdout);
+        collect('stderr', onStderr);
+
+        let failedToStart = null;
+        child.on('error', error => {
+            failedToStart = error;
+        });
+        child.on('close', (code, killSignal) => {
+            clearTimeout(timer);
+            if (signal) {
+                signal.removeEventListener('abort', onAbort);
+            }
+            if (!stopped && !failedToStart && code === 0) {
+                resolve(output);
+                return;
+            }
+            let failure;
+            if (stopped === 'timedOut') {
+                failure = new Error('Command timed out');
+            } else if (stopped === 'outputLimitExceeded') {
+                failure = new Error(`Output limit of ${maxOutput} bytes exceeded`);
+            } else if (stopped === 'aborted') {
+                failure = new Error('Command aborted');
+            } else if (failedToStart) {
+                failure = failedToStart;
+            } else {
+                failure = new Error(`Command failed: ${[file, ...args].join(' ')}\n${output.stderr}`);
+                failure.code = code;
+                failure.signal = killSignal;
+            }
+            if (stopped) {
+                failure[stopped] = true;
+            }
+            failure.stdout = output.stdout;
+            failure.stderr = output.stderr;
+            reject(failure);
+        });
+
+        if (input !== undefined) {
+            // A compiler that exits early closes the pipe; its exit status is what counts
+            child.stdin.on('error', error => debugLog('Error writing to stdin:', error.message));
+            child.stdin.end(input);
+        }
+    });
+}
+
+// Whether runFile killed the program (timeout, output limit or abort), in
+// which case anything it started may still be running
+function wasKilled(error) {
+    return Boolean(error.timedOut || error.outputLimitExceeded || error.aborted);
+}
+
+// Wrap a command so it runs under rlimits: CPU seconds (a backstop behind
+// the wall-clock timeout), address space, written file size and open files.
+// The worker container adds the network, memory and pids isolation.
+function limitedCommand(command) {
+    return [
+        'prlimit',
+        `--cpu=${Math.ceil(EXECUTION_TIMEOUT / 1000)}`,
+        `--as=${EXECUTION_MEMORY_LIMIT_MB * 1024 * 1024}`,
+        `--fsize=${EXECUTION_FILE_SIZE_LIMIT_MB * 1024 * 1024}`,
+        '--nofile=64',
+        '--', command
+    ];
+}
+
+// Host directories mounted into every container, with where they appear:
+// the temp directory at /workspace and, when it lives elsewhere (on a
+// tmpfs), the workspace ring at /scratch
+function containerMounts() {
+    const mounts = [[tempDir, '/workspace']];
+    if (!isInside(workspaceDir, tempDir)) {
+        mounts.push([workspaceDir, '/scratch']);
+    }
+    return mounts;
+}
+
+function mountArgs() {
+    return containerMounts().flatMap(([host, mounted]) => ['-v', `${host}:${mounted}`]);
+}
+
+function isInside(file, dir) {
+    const relative = path.relative(dir, file);
+    return relative !== '..' && !relative.startsWith(`..${path.sep}`) && !path.isAbsolute(relative);
+}
+
+// Path of a file under a mounted directory as a container sees it
+function containerPath(hostPath) {
+    const [host, mounted] = containerMounts().reverse().find(([host]) => isInside(hostPath, host));
+    return path.posix.join(mounted, path.relative(host, hostPath).split(path.sep).join('/'));
+}
+
+// Run a command in a one-shot container with the temp directory and the
+// workspace ring mounted (see containerMounts), under cgroup limits: `memory` (EXECUTION_MEMORY_LIMIT_MB by
+// default), `cpus` (EXECUTION_CPUS) and a pids cap. The other options are
+// runFile's. The container is named, so one whose client is killed (see
+// runFile) is removed instead of running on detached.
+async function runOneShot(image, args, {
+    memory = `${EXECUTION_MEMORY_LIMIT_MB}m`,
+    cpus = EXECUTION_CPUS,
+    network,
+    ...options
+} = {}) {
+    const name = `one_shot_${process.pid}_${crypto.randomUUID()}`;
+    try {
+        return await runFile('docker', [
+            'run', '--rm', '--name', name,
+            ...(options.input === undefined ? [] : ['-i']),
+            ...(network ? ['--network', network] : []),
+            '--memory', memory,
+            '--cpus', cpus,
+            '--pids-limit', '256',
+            ...mountArgs(), '-w', '/workspace',
+            image, ...args
+        ], options);
+    } catch (error) {
+        if (wasKilled(error)) {
+            runFile('docker', ['rm', '-f', name]).catch(() => {});
+        }
+        throw error;
+    }
+}
+
+// Pool of long-lived, sandboxed compiler workers. Each worker is a detached
+// container (no network, capped memory and pids) idling in `sleep infinity`
+// with the temp directory and the workspace ring mounted (see
+// containerMounts). Jobs are dispatched to an
+// idle worker with `docker exec`, so a check pays for a process spawn in a
+// warm container instead of a container start. A worker is recycled after
+// COMPILER_WORKER_MAX_JOBS jobs, and immediately after a job is killed (for
+// its timeout or its output) since the runaway process may still be alive
+// inside it. Jobs run one at a time per worker, so the container's memory
+// and CPU limits apply to each job on its own.
+//
+// With COMPILER_SANDBOX=none the commands run directly on the host (as the C
+// checker always has), and the pool only bounds how many run at once.
+class CompilerPool {
+    constructor({ image, size, maxJobs, sandbox }) {
+        this.image = image;
+        this.size = Math.max(1, size);
+        this.maxJobs = maxJobs;
+        this.sandbox = sandbox;
+        this.workers = new Set();
+        this.idle = [];
+        this.waiting = [];
+        this.nextId = 0;
+        this.warm = false;
+        this.stopped = false;
+    }
+
+    // Pre-warm every worker. If docker is unavailable the pool stays cold
+    // and run() falls back to one-shot `docker run --rm` containers.
+    async start() {
+        if (this.sandbox === 'none') {
+            for (let i = 0; i < this.size; i++) {
+                this.idle.push({ name: `host_${i}`, jobs: 0 });
+            }
+            this.warm = true;
+            return;
+        }
+        const results = await Promise.allSettled(
+            Array.from({ length: this.size }, () => this.createWorker())
+        );
+        const failed = results.filter(r => r.status === 'rejected');
+        if (failed.length === results.length) {
+            console.error('Compiler pool failed to start, using one-shot containers:', failed[0].reason.message);
+            return;
+        }
+        this.warm = true;
+        debugLog(`Compiler pool started ${results.length - failed.length}/${this.size} workers`);
+    }
+
+    async createWorker() {
+        const name = `compiler_worker_${process.pid}_${this.nextId++}`;
+        await timeStage('container_start', () => runFile('docker', [
+            'run', '-d', '--rm', '--name', name,
+            '--network', 'none',
+            '--memory', COMPILER_WORKER_MEMORY,
+            '--cpus', COMPILER_WORKER_CPUS,
+            '--pids-limit', '256',
+            ...mountArgs(), '-w', '/workspace',
+            this.image, 'sleep', 'infinity'
+        ], { timeout: COMPILE_TIMEOUT }));
+        const worker = { name, jobs: 0 };
+        this.workers.add(worker);
+        this.releaseWorker(worker);
+        return worker;
+    }
+
+    // Replace a recycled worker, retrying with backoff while docker fails.
+    // Once the pool has lost every worker it goes cold: waiting jobs and new
+    // ones run in one-shot containers until a replacement starts.
+    async replaceWorker(attempt = 0) {
+        if (this.stopped) {
+            return;
+        }
+        try {
+            const worker = await this.createWorker();
+            if (this.stopped) {
+                await this.destroyWorker(worker);
+                return;
+            }
+            this.warm = true;
+        } catch (error) {
+            console.error(`Error replacing compiler worker (attempt ${attempt + 1}):`, error.message);
+            if (!this.workers.size) {
+                this.warm = false;
+                for (const next of this.waiting.splice(0)) {
+                    next(null);
+                }
+            }
+            setTimeout(() => this.replaceWorker(attempt + 1), Math.min(30000, 1000 * 2 ** attempt)).unref();
+        }
+    }
+
+    async destroyWorker(worker) {
+        this.workers.delete(worker);
+        try {
+            await runFile('docker', ['rm', '-f', worker.name], { timeout: COMPILE_TIMEOUT });
+        } catch (error) {
+            debugLog('Error removing compiler worker:', error.message);
+        }
+    }
+
+    // A pinned job (see run) takes its own worker when that one is idle,
+    // otherwise any idle worker, and only waits when none is. Waiters get
+    // null if the pool goes cold first.
+    acquireWorker(preferred) {
+        const i = preferred ? this.idle.indexOf(preferred) : -1;
+        const worker = i >= 0 ? this.idle.splice(i, 1)[0] : this.idle.pop();
+        if (worker) {
+            return Promise.resolve(worker);
+        }
+        return new Promise(resolve => this.waiting.push(resolve));
+    }
+
+    // The idle worker called `name`, for pins that name their worker
+    // because they come from another process
+    idleWorker(name) {
+        return this.idle.find(worker => worker.name === name) || null;
+    }
+
+    releaseWorker(worker) {
+        const next = this.waiting.shift();
+        if (next) {
+            next(worker);
+        } else {
+            this.idle.push(worker);
+        }
+    }
+
+    recycleWorker(worker) {
+        if (this.sandbox === 'none') {
+            worker.jobs = 0;
+            this.releaseWorker(worker);
+            return;
+        }
+        this.destroyWorker(worker).then(() => this.replaceWorker());
+    }
+
+    // Path of a file under a mounted directory as a job sees it.
+    pathFor(hostPath) {
+        return this.sandbox === 'none' ? hostPath : containerPath(hostPath);
+    }
+
+    // Run a command (argv array) in an idle worker, with `input` (if given)
+    // piped to its stdin; the other options are runFile's. `pin` ({ worker })
+    // keeps a caller's jobs on the worker that ran its last one, whose page
+    // cache already holds the files those jobs share (a session's preamble
+    // PCH).
+    async run(args, { timeout = COMPILE_TIMEOUT, input, onStdout, onStderr, maxOutput, signal, pin, buffer } = {}) {
+        const stdin = input === undefined ? [] : ['-i'];
+        const options = { timeout, input, onStdout, onStderr, maxOutput, signal, buffer };
+        const oneShot = () => runOneShot(this.image, args, { ...options, memory: COMPILER_WORKER_MEMORY, cpus: COMPILER_WORKER_CPUS, network: 'none' });
+        if (!this.warm) {
+            return oneShot();
+        }
+
+        const worker = await this.acquireWorker(pin && pin.worker);
+        if (!worker) {
+            return oneShot();
+        }
+        if (pin) {
+            pin.worker = worker;
+        }
+        let killed = false;
+        try {
+            worker.jobs++;
+            if (this.sandbox === 'none') {
+                return await runFile(args[0], args.slice(1), options);
+            }
+            return await runFile('docker', ['exec', ...stdin, worker.name, ...args], options);
+        } catch (error) {
+            killed = wasKilled(error);
+            throw error;
+        } finally {
+            if (killed || worker.jobs >= this.maxJobs) {
+                this.recycleWorker(worker);
+            } else {
+                this.releaseWorker(worker);
+            }
+        }
+    }
+
+    stats() {
+        const workers = this.sandbox === 'none' ? (this.warm ? this.size : 0) : this.workers.size;
+        return { workers, busy: Math.max(0, workers - this.idle.length), queued: this.waiting.length };
+    }
+
+    async stop() {
+        this.warm = false;
+        this.stopped = true;
+        await Promise.all([...this.workers].map(worker => this.destroyWorker(worker)));
+    }
+}
+
+// Pool of worker threads running babel_worker.js, so JavaScript/TypeScript
+// parses use every core and never block the event loop. Each worker parses
+// one source at a time; the source is sent as UTF-8 bytes whose buffer is
+// transferred, not copied. A worker that exceeds JS_PARSE_TIMEOUT (or
+// crashes) is terminated and replaced.
+class JavaScriptWorkerPool {
+    constructor({ size, timeout }) {
+        this.size = Math.max(1, size);
+        this.timeout = timeout;
+        this.idle = [];
+        this.waiting = [];
+        this.nextId = 0;
+        this.encoder = new TextEncoder();
+        for (let i = 0; i < this.size; i++) {
+            this.idle.push(this.createWorker());
+        }
+    }
+
+    createWorker() {
+        const worker = new Worker(path.join(__dirname, 'babel_worker.js'));
+        worker.job = null;
+        worker.on('message', ({ id, result }) => {
+            if (worker.job && worker.job.id === id) {
+                this.finish(worker, result);
+            }
+        });
+        worker.on('error', error => {
+            console.error('JavaScript worker failed:', error);
+            this.replace(worker, { valid: false, error: 'Syntax checker failed', retryable: true });
+        });
+        worker.on('exit', () => {
+            this.replace(worker, { valid: false, error: 'Syntax checker exited', retryable: true });
+        });
+        return worker;
+    }
+
+    check(code) {
+        return new Promise(resolve => {
+            const job = { id: this.nextId++, code, resolve };
+            const worker = this.idle.pop();
+            if (worker) {
+                this.send(worker, job);
+            } else {
+                this.waiting.push(job);
+            }
+        });
+    }
+
+    send(worker, job) {
+        worker.job = job;
+        job.timer = setTimeout(() => {
+            this.replace(worker, { valid: false, error: `Parsing timed out after ${this.timeout}ms`, retryable: true });
+        }, this.timeout);
+        const source = this.encoder.encode(job.code);
+        job.code = null;
+        worker.postMessage({ id: job.id, source }, [source.buffer]);
+    }
+
+    finish(worker, result) {
+        const job = worker.job;
+        worker.job = null;
+        clearTimeout(job.timer);
+        job.resolve(result);
+        const next = this.waiting.shift();
+        if (next) {
+            this.send(worker, next);
+        } else if (!this.stopped) {
+            this.idle.push(worker);
+        }
+    }
+
+    // Retire a worker that cannot finish its job, answering the job with `result`
+    replace(worker, result) {
+        if (worker.retired) {
+            return;
+        }
+        worker.retired = true;
+        this.idle = this.idle.filter(w => w !== worker);
+        worker.removeAllListeners('message');
+        worker.terminate();
+        if (this.stopped) {
+            return;
+        }
+        const job = worker.job;
+        const fresh = this.createWorker();
+        if (job) {
+            worker.job = null;
+            clearTimeout(job.timer);
+            job.resolve(result);
+        }
+        const next = this.waiting.shift();
+        if (next) {
+            this.send(fresh, next);
+        } else {
+            this.idle.push(fresh);
+        }
+    }
+
+    stats() {
+        return { workers: this.size, busy: this.size - this.idle.length, queued: this.waiting.length };
+    }
+
+    async stop() {
+        this.stopped = true;
+        await Promise.all(this.idle.map(worker => worker.terminate()));
+    }
+}
+
+// Pool of long-lived python3 processes running python_worker.py through
+// python-shell in JSON mode: one request per line on stdin, one reply per
+// line on stdout, answered in order. Checks skip interpreter startup, and
+// several may be pipelined to a worker; each goes to the worker with the
+// fewest outstanding. A worker whose oldest request outlives COMPILE_TIMEOUT
+// (or that exits) is killed and replaced, failing its requests as retryable.
+class PythonWorkerPool {
+    constructor({ size, timeout }) {
+        this.timeout = timeout;
+        this.nextId = 0;
+        this.workers = Array.from({ length: Math.max(1, size) }, () => this.createWorker());
+    }
+
+    createWorker() {
+        const shell = new PythonShell('python_worker.py', {
+            mode: 'json',
+            pythonPath: '/usr/bin/python3',
+            pythonOptions: ['-u'],
+            scriptPath: __dirname
+        });
+        const worker = { shell, pending: new Map(), timer: null };
+        shell.on('message', reply => this.finish(worker, reply));
+        shell.on('stderr', line => debugLog('Python worker:', line));
+        shell.on('error', error => {
+            console.error('Python worker failed:', error.message);
+            this.replace(worker, 'Syntax checker failed');
+        });
+        shell.on('close', () => this.replace(worker, 'Syntax checker exited'));
+        return worker;
+    }
+
+    check(code) {
+        return new Promise(resolve => {
+            const worker = this.workers.reduce((best, w) => w.pending.size < best.pending.size ? w : best);
+            const id = this.nextId++;
+            worker.pending.set(id, { resolve, sentAt: Date.now() });
+            if (!worker.timer) {
+                this.armTimer(worker);
+            }
+            worker.shell.send({ id, code });
+        });
+    }
+
+    // Watch the oldest outstanding request (replies come back in order)
+    armTimer(worker) {
+        const oldest = worker.pending.values().next().value;
+        const remaining = oldest.sentAt + this.timeout - Date.now();
+        worker.timer = setTimeout(() => this.replace(worker, 'Syntax check timed out'), Math.max(0, remaining));
+    }
+
+    finish(worker, reply) {
+        const job = worker.pending.get(reply.id);
+        if (!job) {
+            return;
+        }
+        worker.pending.delete(reply.id);
+        clearTimeout(worker.timer);
+        worker.timer = null;
+        if (worker.pending.size) {
+            this.armTimer(worker);
+        }
+        job.resolve(pythonSyntaxResult(reply));
+    }
+
+    replace(worker, error) {
+        const index = this.workers.indexOf(worker);
+        if (index < 0) {
+            return;
+        }
+        clearTimeout(worker.timer);
+        worker.shell.kill();
+        if (!this.stopped) {
+            this.workers[index] = this.createWorker();
+        } else {
+            this.workers.splice(index, 1);
+        }
+        for (const job of worker.pending.values()) {
+            job.resolve({ valid: false, error, retryable: true });
+        }
+    }
+
+    // Requests are pipelined, so each busy worker has one in progress and
+    // the rest of its pending requests queued behind it
+    stats() {
+        const busy = this.workers.filter(worker => worker.pending.size).length;
+        const pending = this.workers.reduce((total, worker) => total + worker.pending.size, 0);
+        return { workers: this.workers.length, busy, queued: pending - busy };
+    }
+
+    async stop() {
+        this.stopped = true;
+        for (const worker of [...this.workers]) {
+            this.replace(worker, 'Server is shutting down');
+        }
+    }
+}
+
+// Pool of resident JVMs running JavaCheckService.java, which compiles with
+// javax.tools entirely in memory and runs programs in isolated class loaders
+// (see that file for the protocol). With the docker sandbox each JVM lives
+// in its own container without network and with capped memory and pids.
+// Requests are pipelined to the least-loaded JVM and answered in order; one
+// that outlives its deadline (or a JVM that exits, as it does after a run
+// times out) has its JVM replaced. If JVMs keep failing to start, the pool
+// reports itself unavailable and callers fall back to one-shot containers.
+class JavaServicePool {
+    constructor({ size, sandbox }) {
+        this.sandbox = sandbox;
+        this.nextId = 0;
+        this.nextWorker = 0;
+        this.failedStarts = 0;
+        this.available = true;
+        this.workers = Array.from({ length: Math.max(1, size) }, () => this.createWorker());
+    }
+
+    command(name) {
+        const service = path.join(__dirname, 'JavaCheckService.java');
+        const limits = [String(EXECUTION_TIMEOUT), String(EXECUTION_OUTPUT_LIMIT)];
+        if (this.sandbox === 'none') {
+            return ['java', service, ...limits];
+        }
+        return [
+            'docker', 'run', '-i', '--rm', '--name', name,
+            '--network', 'none',
+            '--memory', COMPILER_WORKER_MEMORY,
+            '--cpus', COMPILER_WORKER_CPUS,
+            '--pids-limit', '256',
+            '-v', `${service}:/service/JavaCheckService.java:ro`,
+            DOCKER_JAVA_IMAGE, 'java', '/service/JavaCheckService.java', ...limits
+        ];
+    }
+
+    createWorker() {
+        const name = `java_service_${process.pid}_${this.nextWorker++}`;
+        const [file, ...args] = this.command(name);
+        const child = spawn(file, args, { stdio: ['pipe', 'pipe', 'pipe'] });
+        const worker = { name, child, pending: new Map(), timer: null, answered: false };
+
+        let buffered = '';
+        child.stdout.setEncoding('utf8');
+        child.stdout.on('data', chunk => {
+            buffered += chunk;
+            let newline;
+            while ((newline = buffered.indexOf('\n')) >= 0) {
+                const line = buffered.slice(0, newline);
+                buffered = buffered.slice(newline + 1);
+                try {
+                    this.finish(worker, JSON.parse(line));
+                } catch (error) {
+                    debugLog('Unreadable Java service reply:', line);
+                }
+            }
+        });
+        child.stderr.setEncoding('utf8');
+        child.stderr.on('data', chunk => debugLog('Java service:', chunk.trim()));
+        child.stdin.on('error', error => debugLog('Error writing to Java service:', error.message));
+        child.on('error', error => {
+            console.error('Java service failed to start:', error.message);
+            this.available = false;
+            this.replace(worker, 'Java service unavailable');
+        });
+        child.on('exit', () => this.replace(worker, 'Java service exited'));
+        return worker;
+    }
+
+    // Resolves with the service's reply; rejects (retryable) if the JVM
+    // dies or misses the deadline. onPartial receives the interim replies a
+    // 'stream' request gets before its final one.
+    request(operation, code, timeout, onPartial) {
+        if (!this.available) {
+            return Promise.reject(new Error('Java service unavailable'));
+        }
+        return new Promise((resolve, reject) => {
+            const worker = this.workers.reduce((best, w) => w.pending.size < best.pending.size ? w : best);
+            const id = String(this.nextId++);
+            worker.pending.set(id, { resolve, reject, onPartial, deadline: Date.now() + timeout });
+            if (!worker.timer) {
+                this.armTimer(worker);
+            }
+            const source = Buffer.from(code, 'utf8');
+            worker.child.stdin.write(`${id} ${operation} ${source.length}\n`);
+            worker.child.stdin.write(source);
+        });
+    }
+
+    armTimer(worker) {
+        const oldest = worker.pending.values().next().value;
+        worker.timer = setTimeout(() => this.replace(worker, 'Java service timed out'), Math.max(0, oldest.deadline - Date.now()));
+    }
+
+    finish(worker, reply) {
+        const job = worker.pending.get(reply.id);
+        if (!job) {
+            return;
+        }
+        if (reply.partial) {
+            if (job.onPartial) {
+                job.onPartial(reply);
+            }
+            return;
+        }
+        worker.answered = true;
+        this.failedStarts = 0;
+        worker.pending.delete(reply.id);
+        clearTimeout(worker.timer);
+        worker.timer = null;
+        if (worker.pending.size) {
+            this.armTimer(worker);
+        }
+        job.resolve(reply);
+    }
+
+    replace(worker, error) {
+        const index = this.workers.indexOf(worker);
+        if (index < 0) {
+            return;
+        }
+        clearTimeout(worker.timer);
+        worker.child.kill();
+        if (this.sandbox !== 'none') {
+            runFile('docker', ['rm', '-f', worker.name]).catch(() => {});
+        }
+        if (!worker.answered && ++this.failedStarts >= 3) {
+            this.available = false;
+        }
+        if (this.available && !this.stopped) {
+            this.workers[index] = this.createWorker();
+        } else if (this.workers.length > 1) {
+            this.workers.splice(index, 1);
+        }
+        for (const job of worker.pending.values()) {
+            const failure = new Error(error);
+            failure.retryable = true;
+            job.reject(failure);
+        }
+    }
+
+    // Requests are pipelined, so each busy worker has one in progress and
+    // the rest of its pending requests queued behind it
+    stats() {
+        const busy = this.workers.filter(worker => worker.pending.size).length;
+        const pending = this.workers.reduce((total, worker) => total + worker.pending.size, 0);
+        return { workers: this.available ? this.workers.length : 0, busy, queued: pending - busy };
+    }
+
+    async stop() {
+        this.stopped = true;
+        for (const worker of [...this.workers]) {
+            this.replace(worker, 'Server is shutting down');
+        }
+    }
+}
+
+// Raised by AdmissionScheduler.admit() when a language's queue is full
+class AdmissionError extends Error {
+    constructor(language, retryAfter) {
+        super(`Too many ${language} checks are queued`);
+        this.retryAfter = retryAfter;
+    }
+}
+
+// Admission control in front of every check. Jobs cost a per-language
+// weight in units out of a shared capacity (a JVM start costs far more than
+// a Babel parse), so heavy languages cannot crowd out light ones. Each
+// language has a bounded queue: past SCHEDULER_QUEUE_LIMIT waiting jobs
+// admit() rejects with an AdmissionError carrying a Retry-After estimate
+// from the measured run times, instead of letting latency grow without
+// bound. Within a language, waiting jobs are served round-robin by API key,
+// so one client's burst only delays that client; languages are served
+// round-robin too. Lighter languages' jobs may start while a heavy one
+// waits for room, but each lane keeps a deficit of the units that went past
+// it: once that reaches what its job needs, dispatch holds back the other
+// lanes until the heavy job fits, so it is never starved.
+class AdmissionScheduler {
+    constructor({ capacity, queueLimit, weights }) {
+        this.capacity = Math.max(1, capacity);
+        this.queueLimit = queueLimit;
+        this.weights = weights;
+        this.inUse = 0;
+        this.languages = new Map();
+        this.order = [];
+        this.turn = 0;
+    }
+
+    lane(language) {
+        if (!this.languages.has(language)) {
+            this.languages.set(language, {
+                keys: new Map(), // API key -> FIFO of waiting jobs, in round-robin order
+                queued: 0,
+                running: 0,
+                admitted: 0,
+                rejected: 0,
+                averageMs: 0,
+                deficit: 0 // units started past this lane's job while it did not fit
+            });
+            this.order.push(language);
+        }
+        return this.languages.get(language);
+    }
+
+    // Resolves with a release() function once the job may start. Aborting
+    // `signal` takes a job that is still waiting out of its queue.
+    admit(language, apiKey, signal) {
+        const lane = this.lane(language);
+        if (lane.queued >= this.queueLimit) {
+            lane.rejected++;
+            const perJobMs = lane.averageMs || COMPILE_TIMEOUT;
+            const retryAfter = Math.max(1, Math.ceil(perJobMs * lane.queued / Math.max(1, lane.running) / 1000));
+            return Promise.reject(new AdmissionError(language, retryAfter));
+        }
+        const units = Math.min(this.capacity, this.weights[language] || 1);
+        return new Promise((resolve, reject) => {
+            if (!lane.keys.has(apiKey)) {
+                lane.keys.set(apiKey, []);
+            }
+            const job = { units, resolve };
+            if (signal) {
+                const onAbort = () => {
+                    const jobs = lane.keys.get(apiKey);
+                    const index = jobs ? jobs.indexOf(job) : -1;
+                    if (index !== -1) {
+                        jobs.splice(index, 1);
+                        if (!jobs.length) {
+                            lane.keys.delete(apiKey);
+                        }
+                        if (!--lane.queued) {
+                            lane.deficit = 0;
+                        }
+                        reject(new Error('Admission cancelled'));
+                        this.dispatch();
+                    }
+                };
+                signal.addEventListener('abort', onAbort, { once: true });
+                job.resolve = release => {
+                    signal.removeEventListener('abort', onAbort);
+                    resolve(release);
+                };
+            }
+            lane.keys.get(apiKey).push(job);
+            lane.queued++;
+            this.dispatch();
+        });
+    }
+
+    // Next job of a language, taking API keys in turn
+    takeFrom(lane) {
+        const [apiKey, jobs] = lane.keys.entries().next().value;
+        const job = jobs.shift();
+        lane.keys.delete(apiKey);
+        if (jobs.length) {
+            lane.keys.set(apiKey, jobs); // to the back of the rotation
+        }
+        lane.queued--;
+        return job;
+    }
+
+    // First waiting job of a lane with jobs queued
+    head(lane) {
+        return lane.keys.values().next().value[0];
+    }
+
+    dispatch() {
+        for (let scanned = 0; scanned < this.order.length;) {
+            const language = this.order[this.turn % this.order.length];
+            const lane = this.languages.get(language);
+            if (!lane.queued) {
+                this.turn++;
+                scanned++;
+                continue;
+            }
+            const head = this.head(lane);
+            if (this.inUse + head.units > this.capacity) {
+                if (lane.deficit >= head.units) {
+                    return; // passed over long enough: wait for capacity for it
+                }
+                this.turn++;
+                scanned++;
+                continue;
+            }
+            const job = this.takeFrom(lane);
+            lane.deficit = 0;
+            this.turn++;
+            scanned = 0;
+            this.passOver(lane, job.units);
+            this.start(language, lane, job);
+        }
+    }
+
+    // Charge a job starting from `started` to the lanes whose waiting job
+    // does not fit
+    passOver(started, units) {
+        for (const lane of this.languages.values()) {
+            if (lane !== started && lane.queued && this.inUse + this.head(lane).units > this.capacity) {
+                lane.deficit += units;
+            }
+        }
+    }
+
+    start(language, lane, job) {
+        this.inUse += job.units;
+        lane.running++;
+        lane.admitted++;
+        const startedAt = Date.now();
+        let released = false;
+        job.resolve(() => {
+            if (released) {
+                return;
+            }
+            released = true;
+            this.inUse -= job.units;
+            lane.running--;
+            const elapsed = Date.now() - startedAt;
+            lane.averageMs = lane.averageMs ? lane.averageMs * 0.8 + elapsed * 0.2 : elapsed;
+            this.dispatch();
+        });
+    }
+
+    stats() {
+        const languages = {};
+        for (const [language, lane] of this.languages) {
+            languages[language] = {
+                running: lane.running,
+                queued: lane.queued,
+                admitted: lane.admitted,
+                rejected: lane.rejected,
+                averageMs: Math.round(lane.averageMs)
+            };
+        }
+        return { capacity: this.capacity, inUse: this.inUse, languages };
+    }
+}
+
+// Parse "java=8,cpp=6" into { java: 8, cpp: 6 }
+function parseWeights(spec) {
+    const weights = {};
+    for (const entry of spec.split(',')) {
+        const [language, weight] = entry.split('=').map(part => part.trim());
+        if (language && Number(weight) > 0) {
+            weights[language] = Number(weight);
+        }
+    }
+    return weights;
+}
+
+// Prometheus metrics, in the text exposition format. Counters and
+// histograms are kept here; gauges are read from the pools, the scheduler
+// and the cache when /metrics is scraped.
+function escapeLabelValue(value) {
+    return String(value).replace(/\\/g, '\\\\').replace(/"/g, '\\"').replace(/\n/g, '\\n');
+}
+
+function formatLabels(labels) {
+    const entries = Object.entries(labels);
+    return entries.length ? `{${entries.map(([name, value]) => `${name}="${escapeLabelValue(value)}"`).join(',')}}` : '';
+}
+
+class Counter {
+    constructor(name, help, labelNames = []) {
+        this.name = name;
+        this.help = help;
+        this.labelNames = labelNames;
+        this.series = new Map();
+    }
+
+    labelsOf(labels) {
+        return Object.fromEntries(this.labelNames.map(name => [name, labels[name] === undefined ? '' : labels[name]]));
+    }
+
+    inc(labels = {}, amount = 1) {
+        const key = formatLabels(this.labelsOf(labels));
+        this.series.set(key, (this.series.get(key) || 0) + amount);
+    }
+
+    // The series as plain data, for another process to merge()
+    snapshot() {
+        return [...this.series];
+    }
+
+    merge(snapshot) {
+        for (const [key, value] of snapshot) {
+            this.series.set(key, (this.series.get(key) || 0) + value);
+        }
+    }
+
+    // An empty metric of the same kind, to merge snapshots into
+    blank() {
+        return new Counter(this.name, this.help, this.labelNames);
+    }
+
+    render() {
+        const lines = [`# HELP ${this.name} ${this.help}`, `# TYPE ${this.name} counter`];
+        for (const [key, value] of this.series) {
+            lines.push(`${this.name}${key} ${value}`);
+        }
+        return lines.join('\n');
+    }
+}
+
+class Histogram extends Counter {
+    constructor(name, help, labelNames, buckets) {
+        super(name, help, labelNames);
+        this.buckets = buckets;
+    }
+
+    observe(labels, value) {
+        const fixed = this.labelsOf(labels);
+        const key = formatLabels(fixed);
+        let series = this.series.get(key);
+        if (!series) {
+            series = { labels: fixed, counts: new Array(this.buckets.length).fill(0), sum: 0, count: 0 };
+            this.series.set(key, series);
+        }
+        const bucket = this.buckets.findIndex(bound => value <= bound);
+        if (bucket >= 0) {
+            series.counts[bucket]++;
+        }
+        series.sum += value;
+        series.count++;
+    }
+
+    merge(snapshot) {
+        for (const [key, other] of snapshot) {
+            const series = this.series.get(key);
+            if (!series) {
+                this.series.set(key, { ...other, counts: [...other.counts] });
+                continue;
+            }
+            other.counts.forEach((count, i) => {
+                series.counts[i] += count;
+            });
+            series.sum += other.sum;
+            series.count += other.count;
+        }
+    }
+
+    blank() {
+        return new Histogram(this.name, this.help, this.labelNames, this.buckets);
+    }
+
+    render() {
+        const lines = [`# HELP ${this.name} ${this.help}`, `# TYPE ${this.name} histogram`];
+        for (const { labels, counts, sum, count } of this.series.values()) {
+            let cumulative = 0;
+            this.buckets.forEach((bound, i) => {
+                cumulative += counts[i];
+                lines.push(`${this.name}_bucket${formatLabels({ ...labels, le: bound })} ${cumulative}`);
+            });
+            lines.push(`${this.name}_bucket${formatLabels({ ...labels, le: '+Inf' })} ${count}`);
+            lines.push(`${this.name}_sum${formatLabels(labels)} ${sum}`);
+            lines.push(`${this.name}_count${formatLabels(labels)} ${count}`);
+        }
+        return lines.join('\n');
+    }
+}
+
+// A gauge (or a counter kept elsewhere) as [labels, value] samples
+function renderSamples(name, help, type, samples) {
+    const lines = [`# HELP ${name} ${help}`, `# TYPE ${name} ${type}`];
+    for (const [labels, value] of samples) {
+        lines.push(`${name}${formatLabels(labels)} ${value}`);
+    }
+    return lines.join('\n');
+}
+
+const LATENCY_BUCKETS = [0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30];
+
+const stageDuration = new Histogram(
+    'syntax_checker_stage_duration_seconds',
+    'Time spent in each stage of handling a submission.',
+    ['stage', 'language', 'standard'], LATENCY_BUCKETS
+);
+const requestDuration = new Histogram(
+    'syntax_checker_request_duration_seconds',
+    'Time from a request arriving to its response finishing.',
+    ['route', 'status'], LATENCY_BUCKETS
+);
+
+// The submission being handled, so that stages deep in a checker (a
+// compiler run, a container start) are labelled with its language
+const requestContext = new AsyncLocalStorage();
+
+function observeStage(stage, seconds, { language, standard = '' } = {}) {
+    const current = requestContext.getStore();
+    stageDuration.observe({ stage, language: language || (current && current.language) || '', standard }, seconds);
+}
+
+// Run `work` and record how long it took as `stage`
+async function timeStage(stage, work, labels) {
+    const started = performance.now();
+    try {
+        return await work();
+    } finally {
+        observeStage(stage, (performance.now() - started) / 1000, labels);
+    }
+}
+
+// The -std a result was checked under ('C++20' -> 'c++20'), for labels
+function standardLabel(result) {
+    return result && result.standard && result.standard !== 'Unknown' ? result.standard.toLowerCase() : '';
+}
+
+// Middleware
+app.use(cors());
+const parseJsonBody = express.json({
+    limit: MAX_CODE_SIZE
+});
+// Every response is counted and timed by the route it matched
+app.use((req, res, next) => {
+    const started = performance.now();
+    res.on('finish', () => {
+        const route = req.route ? req.route.path : 'unmatched';
+        requestDuration.observe({ route, status: res.statusCode }, (performance.now() - started) / 1000);
+    });
+    next();
+});
+// Batches are parsed by their own route, with a larger limit, after auth.
+// The time to read and parse a body is kept for the json_decode stage.
+app.use((req, res, next) => {
+    if (req.path === '/check-syntax/batch') {
+        return next();
+    }
+    const started = performance.now();
+    parseJsonBody(req, res, error => {
+        req.jsonDecodeSeconds = (performance.now() - started) / 1000;
+        next(error);
+    });
+});
+
+// Authentication middleware
+const authenticateRequest = (req, res, next) => {
+    const apiKey = req.headers['x-api-key'];
+    if (!apiKey) {
+        return res.status(401).json({ error: 'API key is required' });
+    }
+    // In production, you would validate the API key against a database
+    req.apiKey = apiKey;
+    next();
+};
+
+// Cluster mode (CLUSTER_WORKERS > 1): the primary forks HTTP workers that
+// share the port, and keeps everything that must be shared for itself: the
+// compiler, Python and Java pools, the scheduler and the result cache. A
+// worker reaches them through the clients below, which have the interfaces
+// of the real objects, so the checkers work unchanged. Each worker keeps
+// its own Babel threads and its own sessions (see sessionOwner).
+
+// An error as plain data, with its fields (timedOut, stderr, retryAfter...)
+function serializeError(error) {
+    return { ...error, name: error.constructor.name, message: error.message };
+}
+
+function deserializeError({ name, message, ...fields }) {
+    const error = name === 'AdmissionError' ? new AdmissionError('', fields.retryAfter) : new Error(message);
+    error.message = message;
+    return Object.assign(error, fields);
+}
+
+// Calls in both directions over a cluster IPC channel (`process` in a
+// worker, a cluster Worker in the primary). A handler receives the call's
+// arguments and { emit, signal }: emit(event, data) reaches the caller's
+// onEvent before the result does, and `signal` aborts when the caller's
+// does. If the other side goes away, its calls fail as retryable.
+class RpcChannel {
+    constructor(endpoint, handlers) {
+        this.endpoint = endpoint;
+        this.handlers = handlers;
+        this.nextId = 0;
+        this.calls = new Map();
+        this.served = new Map();
+        endpoint.on('message', message => this.receive(message));
+    }
+
+    call(method, args, { onEvent, signal } = {}) {
+        return new Promise((resolve, reject) => {
+            const id = this.nextId++;
+            const onAbort = () => this.send({ rpc: 'abort', id });
+            const settle = () => signal && signal.removeEventListener('abort', onAbort);
+            this.calls.set(id, {
+                onEvent,
+                resolve: value => { settle(); resolve(value); },
+                reject: error => { settle(); reject(error); }
+            });
+            if (signal) {
+                signal.addEventListener('abort', onAbort);
+            }
+            this.send({ rpc: 'call', id, method, args });
+        });
+    }
+
+    send(message) {
+        this.endpoint.send(message, error => error && debugLog('IPC send failed:', error.message));
+    }
+
+    receive(message) {
+        if (!message || !message.rpc) {
+            return;
+        }
+        const call = this.calls.get(message.id);
+        switch (message.rpc) {
+            case 'call':
+                this.serve(message);
+                break;
+            case 'abort':
+                if (this.served.has(message.id)) {
+                    this.served.get(message.id).abort();
+                }
+                break;
+            case 'event':
+                if (call && call.onEvent) {
+                    call.onEvent(message.event, message.data);
                 }
-            } else {
-                resolve({ stdout, stderr });
+                break;
+            case 'result':
+            case 'error':
+                if (call) {
+                    this.calls.delete(message.id);
+                    if (message.rpc === 'result') {
+                        call.resolve(message.result);
+                    } else {
+                        call.reject(deserializeError(message.error));
+                    }
+                }
+                break;
+        }
+    }
+
+    async serve({ id, method, args }) {
+        const controller = new AbortController();
+        this.served.set(id, controller);
+        try {
+            if (!this.handlers[method]) {
+                throw new Error(`Unknown call ${method}`);
             }
-        });
+            const emit = (event, data) => this.send({ rpc: 'event', id, event, data });
+            const result = await this.handlers[method](args, { emit, signal: controller.signal });
+            this.send({ rpc: 'result', id, result });
+        } catch (error) {
+            this.send({ rpc: 'error', id, error: serializeError(error) });
+        } finally {
+            this.served.delete(id);
+        }
+    }
+
+    close(reason) {
+        for (const controller of this.served.values()) {
+            controller.abort();
+        }
+        for (const call of this.calls.values()) {
+            const failure = new Error(reason);
+            failure.retryable = true;
+            call.reject(failure);
+        }
+        this.calls.clear();
+    }
+}
+
+// The primary, as a worker sees it
+const primary = IS_WORKER ? new RpcChannel(process, {
+    metrics: () => localMetrics(),
+    session: request => handleSessionRequest(request)
+}) : null;
+if (primary) {
+    process.on('disconnect', () => {
+        primary.close('Primary process exited');
+        process.exit(1);
     });
 }
 
-// Middleware
-app.use(cors());
-app.use(express.json({
-    limit: MAX_CODE_SIZE
-}));
+// The compiler pool from a worker: jobs run in the primary's pool, with
+// output streamed back. Paths are mapped locally, since every process
+// shares the temp directory, and a pin names its worker.
+class CompilerPoolClient extends CompilerPool {
+    async start() {}
 
-// Authentication middleware
-const authenticateRequest = (req, res, next) => {
-    const apiKey = req.headers['x-api-key'];
-    if (!apiKey) {
-        return res.status(401).json({ error: 'API key is required' });
+    async run(args, { timeout, input, onStdout, onStderr, maxOutput, signal, pin, buffer } = {}) {
+        const result = await primary.call('compiler.run', {
+            args,
+            options: { timeout, input, maxOutput, buffer, stdout: Boolean(onStdout), stderr: Boolean(onStderr) },
+            pin: pin ? pin.worker : undefined
+        }, {
+            signal,
+            onEvent: (stream, text) => (stream === 'stdout' ? onStdout : onStderr)(text)
+        });
+        if (pin) {
+            pin.worker = result.pin;
+        }
+        return { stdout: result.stdout, stderr: result.stderr };
     }
-    // In production, you would validate the API key against a database
-    next();
-};
+}
+
+class PythonWorkerPoolClient {
+    check(code) {
+        return primary.call('python.check', { code });
+    }
+
+    async stop() {}
+}
+
+// The primary's JVMs report whether they are still available with every
+// failure, so callers fall back to one-shot containers as they would there
+class JavaServicePoolClient {
+    constructor() {
+        this.available = true;
+    }
+
+    async request(operation, code, timeout, onPartial) {
+        try {
+            return await primary.call('java.request', { operation, code, timeout }, {
+                onEvent: (event, partial) => onPartial && onPartial(partial)
+            });
+        } catch (error) {
+            this.available = error.javaAvailable !== false;
+            throw error;
+        }
+    }
+
+    async stop() {}
+}
+
+// Admission tickets are held in the primary until released
+class AdmissionSchedulerClient {
+    async admit(language, apiKey) {
+        const ticket = await primary.call('scheduler.admit', { language, apiKey });
+        let released = false;
+        return () => {
+            if (!released) {
+                released = true;
+                primary.call('scheduler.release', { ticket }).catch(error => debugLog('Error releasing admission:', error.message));
+            }
+        };
+    }
+}
+
+class ResultCacheClient {
+    get(key) {
+        return primary.call('cache.get', { key });
+    }
+
+    set(key, value) {
+        return primary.call('cache.set', { key, value });
+    }
+}
 
 // Create temp directory if it doesn't exist
-const tempDir = path.join(__dirname, TEMP_DIR);
-fs.mkdir(tempDir, { recursive: true, mode: 0o777 }).catch(console.error);
+const tempDir = path.resolve(__dirname, TEMP_DIR);
+const tempDirReady = fs.mkdir(tempDir, { recursive: true, mode: 0o777 }).catch(console.error);
 
-// Periodic cleanup of temporary files
-setInterval(async () => {
+// Scratch space for checks and runs, preferably on a tmpfs
+function defaultWorkspaceDir() {
     try {
-        const files = await fs.readdir(tempDir);
-        const now = Date.now();
-        for (const file of files) {
-            const filePath = path.join(tempDir, file);
-            const stats = await fs.stat(filePath);
-            if (now - stats.mtimeMs > 3600000) { // Remove files older than 1 hour
-                await cleanupTempFile(filePath);
+        require('fs').accessSync('/dev/shm', require('fs').constants.W_OK);
+        return `/dev/shm/syntax-checker-${PORT}`;
+    } catch (error) {
+        return path.join(tempDir, 'slots');
+    }
+}
+const workspaceDir = WORKSPACE_DIR ? path.resolve(__dirname, WORKSPACE_DIR) : defaultWorkspaceDir();
+
+// Every file a check or a run writes goes into a slot: one of a fixed ring
+// of WORKSPACE_SLOTS directories, created at startup and held by one job at
+// a time, so names inside a slot never clash (two Main.java submissions at
+// once). A returned slot is emptied, which touches only the few entries
+// that job left, and nothing accumulates for a sweep to find. In cluster
+// mode each HTTP worker has a ring of its own.
+class WorkspaceRing {
+    constructor({ root, size }) {
+        this.root = root;
+        this.size = Math.max(1, size);
+        this.free = [];
+        this.waiting = [];
+        this.ready = null;
+    }
+
+    // Whatever an earlier process with this root left is removed first
+    start() {
+        this.ready = (async () => {
+            await fs.rm(this.root, { recursive: true, force: true });
+            await fs.mkdir(this.root, { recursive: true, mode: 0o777 });
+            for (let i = 0; i < this.size; i++) {
+                const dir = path.join(this.root, String(i));
+                await fs.mkdir(dir, { mode: 0o777 });
+                this.free.push({ index: i, dir });
             }
+        })();
+        return this.ready;
+    }
+
+    async acquire() {
+        await this.ready;
+        const slot = this.free.pop();
+        if (slot) {
+            return slot;
         }
-    } catch (error) {
-        console.error('Error during temp file cleanup:', error);
+        return new Promise(resolve => this.waiting.push(resolve));
+    }
+
+    // Empties the slot and hands it on; callers do not wait for this
+    async release(slot) {
+        try {
+            const entries = await fs.readdir(slot.dir);
+            await Promise.all(entries.map(name => fs.rm(path.join(slot.dir, name), { recursive: true, force: true })));
+        } catch (error) {
+            console.error('Error resetting workspace slot:', error);
+        }
+        const next = this.waiting.shift();
+        if (next) {
+            next(slot);
+        } else {
+            this.free.push(slot);
+        }
+    }
+
+    // Run work(dir) in a slot of its own
+    async use(work) {
+        const slot = await this.acquire();
+        try {
+            return await work(slot.dir);
+        } finally {
+            this.release(slot);
+        }
+    }
+
+    stats() {
+        return { slots: this.size, free: this.free.length, waiting: this.waiting.length };
     }
-}, CLEANUP_INTERVAL); // Run every hour
+}
+
+// Each process's ring is a directory of its own under workspaceDir
+function workspaceRoot(processId = IS_WORKER ? cluster.worker.id : null) {
+    return path.join(workspaceDir, processId === null ? 'main' : `worker_${processId}`);
+}
+
+// The primary (or the only process) removes every ring a previous run left.
+// workspaceDir itself must exist before the compiler containers mount it.
+async function clearWorkspaceRings() {
+    await fs.mkdir(workspaceDir, { recursive: true, mode: 0o777 });
+    const entries = await fs.readdir(workspaceDir);
+    await Promise.all(entries.filter(name => /^(main|worker_\d+)$/.test(name))
+        .map(name => fs.rm(path.join(workspaceDir, name), { recursive: true, force: true })));
+}
+
+const workspaceReady = IS_WORKER ? tempDirReady : tempDirReady.then(clearWorkspaceRings);
+const workspace = IS_PRIMARY ? null : new WorkspaceRing({ root: workspaceRoot(), size: WORKSPACE_SLOTS });
+if (workspace) {
+    workspaceReady.then(() => workspace.start()).catch(console.error);
+}
+
+// C and C++ compilers run in the shared worker pool
+const compilerPool = new (IS_WORKER ? CompilerPoolClient : CompilerPool)({
+    image: DOCKER_CPP_IMAGE,
+    size: COMPILER_POOL_SIZE,
+    maxJobs: COMPILER_WORKER_MAX_JOBS,
+    sandbox: COMPILER_SANDBOX
+});
+workspaceReady.then(() => compilerPool.start()).catch(console.error);
+
+// JavaScript/TypeScript parsing runs on worker threads, split between the
+// HTTP workers in cluster mode (the primary parses nothing)
+const jsWorkerPool = IS_PRIMARY ? null : new JavaScriptWorkerPool({
+    size: CLUSTERED ? Math.ceil(JS_WORKER_POOL_SIZE / CLUSTER_WORKERS) : JS_WORKER_POOL_SIZE,
+    timeout: JS_PARSE_TIMEOUT
+});
+
+// Python syntax checks run in persistent interpreters
+const pythonWorkerPool = IS_WORKER
+    ? new PythonWorkerPoolClient()
+    : new PythonWorkerPool({ size: PYTHON_WORKER_POOL_SIZE, timeout: COMPILE_TIMEOUT });
+
+// Java is compiled (and run) by resident JVMs
+const javaService = IS_WORKER
+    ? new JavaServicePoolClient()
+    : new JavaServicePool({ size: JAVA_SERVICE_POOL_SIZE, sandbox: COMPILER_SANDBOX });
+
+// Every check and execution is admitted through the scheduler
+const scheduler = IS_WORKER ? new AdmissionSchedulerClient() : new AdmissionScheduler({
+    capacity: SCHEDULER_CAPACITY,
+    queueLimit: SCHEDULER_QUEUE_LIMIT,
+    weights: parseWeights(SCHEDULER_WEIGHTS)
+});
+
+// Write a file into the temp directory, timed as its own stage
+function writeTempFile(filePath, contents) {
+    return timeStage('temp_file_write', () => fs.writeFile(filePath, contents, 'utf8'));
+}
 
 // Cleanup function for temporary files
 async function cleanupTempFile(filePath) {
@@ -236,54 +1682,74 @@ function adjustErrorLineNumbers(error, language, hasWrapper) {
     return error;
 }
 
+// Every executor takes the code and { onOutput, signal }: onOutput(stream,
+// text) receives the program's stdout and stderr as it writes them, and
+// aborting `signal` stops the program. The fused check-and-run functions
+// also call onChecked(syntaxResult) once the check is done, before the
+// program starts. Output past EXECUTION_OUTPUT_LIMIT bytes kills the program.
+function outputListeners(onOutput) {
+    if (!onOutput) {
+        return {};
+    }
+    return { onStdout: text => onOutput('stdout', text), onStderr: text => onOutput('stderr', text) };
+}
+
+// The executionResult for a program runFile rejected
+function executionFailure(error) {
+    let message = error.message;
+    if (error.outputLimitExceeded) {
+        message = `Output limit exceeded. Your program wrote more than ${EXECUTION_OUTPUT_LIMIT} bytes.`;
+    } else if (error.timedOut) {
+        message = 'Execution timed out. Your code took too long to run.';
+    } else if (error.aborted) {
+        message = 'Execution cancelled.';
+    }
+    return { success: false, output: null, error: message };
+}
+
 // Function to execute JavaScript code
-async function executeJavaScript(code) {
-    const tempFile = path.join(tempDir, `js_${Date.now()}.js`);
-    try {
-        // Write the code directly to file
-        await fs.writeFile(tempFile, code);
-        
-        // Execute the code
-        const { stdout, stderr } = await execAsync(`node "${tempFile}"`);
-        await cleanupTempFile(tempFile);
+async function executeJavaScript(code, { onOutput, signal } = {}) {
+    return workspace.use(async dir => {
+        const tempFile = path.join(dir, 'main.js');
+        try {
+            // Write the code directly to file
+            await writeTempFile(tempFile, code);
 
-        if (stderr) {
-            return { success: false, error: stderr };
-        }
+            // Execute the code
+            const { stdout, stderr } = await runFile('node', [tempFile], {
+                timeout: EXECUTION_TIMEOUT, maxOutput: EXECUTION_OUTPUT_LIMIT, signal, ...outputListeners(onOutput)
+            });
 
-        return {
-            success: true,
-            output: stdout || 'Code executed successfully with no output'
-        };
-    } catch (error) {
-        await cleanupTempFile(tempFile);
-        return { success: false, error: error.message };
-    }
+            if (stderr) {
+                return { success: false, error: stderr };
+            }
+
+            return {
+                success: true,
+                output: stdout || 'Code executed successfully with no output'
+            };
+        } catch (error) {
+            return executionFailure(error);
+        }
+    });
 }
 
 // Function to execute Python code
-async function executePython(code) {
-    const pythonFile = path.join(tempDir, `script_${Date.now()}.py`);
-    try {
-        await fs.writeFile(pythonFile, code);
-        debugLog('Running Python code...');
-        const { stdout, stderr } = await executeWithTimeout(
-            `docker run --rm -v "${tempDir}:/code" -w /code ${DOCKER_PYTHON_IMAGE} python /code/$(basename "${pythonFile}")`,
-            EXECUTION_TIMEOUT
-        );
-        return { success: true, output: stdout, error: stderr || null };
-    } catch (error) {
-        debugLog('Python execution error:', error);
-        return { 
-            success: false, 
-            output: null, 
-            error: error.message.includes('timed out') ? 
-                'Execution timed out. Your code took too long to run.' : 
-                error.message 
-        };
-    } finally {
-        await cleanupTempFile(pythonFile);
-    }
+async function executePython(code, { onOutput, signal } = {}) {
+    return workspace.use(async dir => {
+        const pythonFile = path.join(dir, 'script.py');
+        try {
+            await writeTempFile(pythonFile, code);
+            debugLog('Running Python code...');
+            const { stdout, stderr } = await runOneShot(DOCKER_PYTHON_IMAGE, ['python', containerPath(pythonFile)], {
+                timeout: EXECUTION_TIMEOUT, maxOutput: EXECUTION_OUTPUT_LIMIT, signal, ...outputListeners(onOutput)
+            });
+            return { success: true, output: stdout, error: stderr || null };
+        } catch (error) {
+            debugLog('Python execution error:', error);
+            return executionFailure(error);
+        }
+    });
 }
 
 // Helper function to extract Java class name
@@ -292,247 +1758,528 @@ function extractJavaClassName(code) {
     return classMatch ? classMatch[1] : null;
 }
 
-// Function to execute Java code
-async function executeJava(code) {
-    let javaFile = null;
-    let classFile = null;
+// Check a Java program and, if it compiles, run it, both in one request to
+// a resident JVM (see JavaServicePool). Resolves with
+// { syntaxResult, executionResult }. With onChecked or onOutput the JVM
+// streams the verdict and the output back while the program runs. A run
+// cannot be aborted; its timeout and output limit still apply.
+async function checkAndRunJava(code, { onChecked, onOutput, signal } = {}) {
+    const streaming = Boolean(onChecked || onOutput);
+    const onPartial = partial => {
+        if (partial.stream) {
+            if (onOutput) {
+                onOutput(partial.stream, partial.data);
+            }
+        } else if (onChecked) {
+            onChecked(javaSyntaxResult(partial));
+        }
+    };
+    let reply;
     try {
-        const className = extractJavaClassName(code) || `Solution_${Date.now()}`;
-        javaFile = path.join(tempDir, `${className}.java`);
-        classFile = path.join(tempDir, `${className}.class`);
-        
-        await fs.writeFile(javaFile, code);
-        
-        // Compile Java code with timeout
-        debugLog('Compiling Java code...');
-        await executeWithTimeout(
-            `docker run --rm -v "${tempDir}:/code" -w /code ${DOCKER_JAVA_IMAGE} javac /code/$(basename "${javaFile}")`,
-            COMPILE_TIMEOUT
-        );
-        
-        // Run Java code with timeout
-        debugLog('Running Java code...');
-        const { stdout, stderr } = await executeWithTimeout(
-            `docker run --rm -v "${tempDir}:/code" -w /code ${DOCKER_JAVA_IMAGE} java -cp /code ${className}`,
-            EXECUTION_TIMEOUT
-        );
-        
-        return { success: true, output: stdout, error: stderr || null };
+        reply = await javaService.request(streaming ? 'stream' : 'run', code, COMPILE_TIMEOUT + EXECUTION_TIMEOUT, onPartial);
     } catch (error) {
-        debugLog('Java execution error:', error);
+        if (!javaService.available) {
+            const syntaxResult = await checkJavaSyntaxInContainer(code);
+            if (onChecked) {
+                onChecked(syntaxResult);
+            }
+            return {
+                syntaxResult,
+                executionResult: syntaxResult.valid ? await executeJavaInContainer(code, { onOutput, signal }) : null
+            };
+        }
+        return { syntaxResult: { valid: false, error: error.message, retryable: true }, executionResult: null };
+    }
+    const syntaxResult = javaSyntaxResult(reply);
+    if (!syntaxResult.valid) {
+        return { syntaxResult, executionResult: null };
+    }
+    let executionResult;
+    if (reply.outputLimitExceeded) {
+        executionResult = executionFailure({ outputLimitExceeded: true });
+    } else if (reply.timedOut) {
+        executionResult = executionFailure({ timedOut: true });
+    } else if (reply.exitStatus !== 0) {
+        executionResult = { success: false, output: reply.stdout, error: reply.stderr || `Exited with status ${reply.exitStatus}` };
+    } else {
+        executionResult = { success: true, output: reply.stdout, error: reply.stderr || null };
+    }
+    return { syntaxResult, executionResult };
+}
+
+// Function to execute Java code
+async function executeJava(code, options) {
+    return (await checkAndRunJava(code, options)).executionResult;
+}
+
+// Execute Java with javac and java in one-shot containers (used when the
+// resident JVMs cannot start)
+async function executeJavaInContainer(code, { onOutput, signal } = {}) {
+    return workspace.use(async dir => {
+        try {
+            const className = extractJavaClassName(code) || 'Solution';
+            const javaFile = path.join(dir, `${className}.java`);
+
+            await writeTempFile(javaFile, code);
+
+            // Compile Java code with timeout
+            debugLog('Compiling Java code...');
+            await runOneShot(DOCKER_JAVA_IMAGE, ['javac', containerPath(javaFile)], {
+                timeout: COMPILE_TIMEOUT, memory: COMPILER_WORKER_MEMORY, cpus: COMPILER_WORKER_CPUS, signal
+            });
+
+            // Run Java code with timeout
+            debugLog('Running Java code...');
+            const { stdout, stderr } = await runOneShot(DOCKER_JAVA_IMAGE, ['java', '-cp', containerPath(dir), className], {
+                timeout: EXECUTION_TIMEOUT, maxOutput: EXECUTION_OUTPUT_LIMIT, signal, ...outputListeners(onOutput)
+            });
+
+            return { success: true, output: stdout, error: stderr || null };
+        } catch (error) {
+            debugLog('Java execution error:', error);
+            return executionFailure(error);
+        }
+    });
+}
+
+// C and C++ are checked and built by the same compiler run: the syntax
+// checkers take an output path and, when the code is valid, leave the
+// executable there. A failure that is only the link step (an undefined
+// reference) means the syntax is valid but the program cannot run.
+function isLinkFailure(stderr) {
+    return /collect2: error: ld returned|undefined reference to/.test(stderr || '');
+}
+
+// Run a binary built in the temp directory in a worker, under rlimits.
+// C programs have always reported output on stderr as a failure.
+async function runCompiledProgram(execFile, { stderrIsFailure = false, onOutput, signal } = {}) {
+    try {
+        debugLog('Running program...');
+        const { stdout, stderr } = await timeStage('execute', () => compilerPool.run(
+            limitedCommand(compilerPool.pathFor(execFile)),
+            { timeout: EXECUTION_TIMEOUT, maxOutput: EXECUTION_OUTPUT_LIMIT, signal, ...outputListeners(onOutput) }
+        ));
         return { 
-            success: false, 
-            output: null, 
-            error: error.message.includes('timed out') ? 
-                'Execution timed out. Your code took too long to run.' : 
-                error.message 
+            success: stderrIsFailure && stderr ? false : true, 
+            output: stdout, 
+            error: stderr || null 
         };
-    } finally {
-        if (javaFile) await cleanupTempFile(javaFile);
-        if (classFile) await cleanupTempFile(classFile);
+    } catch (error) {
+        debugLog('Execution error:', error);
+        return executionFailure(error);
     }
 }
 
+// Check a C or C++ program and, if it is valid, run the binary the check
+// produced. Resolves with { syntaxResult, executionResult }. The binary's
+// name is unique even within the slot: compiles for other standards (see
+// detectCppStandardParallel) may still be writing after the slot is back.
+async function checkAndRunCompiled(checkSyntax, code, { onChecked, ...runOptions } = {}) {
+    return workspace.use(async dir => {
+        const execFile = path.join(dir, `program_${crypto.randomUUID()}`);
+        const { linkError, ...syntaxResult } = await checkSyntax(code, { output: execFile });
+        if (onChecked) {
+            onChecked(syntaxResult);
+        }
+        let executionResult = null;
+        if (linkError) {
+            executionResult = { success: false, output: null, error: linkError };
+        } else if (syntaxResult.valid) {
+            executionResult = await runCompiledProgram(execFile, runOptions);
+        }
+        return { syntaxResult, executionResult };
+    });
+}
+
+async function checkAndRunCPP(code, options) {
+    return checkAndRunCompiled(checkCPPSyntax, code, options);
+}
+
+async function checkAndRunC(code, options) {
+    return checkAndRunCompiled(checkCSyntax, code, { ...options, stderrIsFailure: true });
+}
+
 // Function to execute C++ code
-async function executeCPP(code) {
-    const timestamp = Date.now();
-    const cppFile = path.join(tempDir, `program_${timestamp}.cpp`);
-    const execFile = path.join(tempDir, `program_${timestamp}`);
-    
+async function executeCPP(code, options) {
+    return (await checkAndRunCPP(code, options)).executionResult;
+}
+
+// Function to execute C code
+async function executeC(code, options) {
+    return (await checkAndRunC(code, options)).executionResult;
+}
+
+// Flags behind every C syntax verdict: the plain check, a check that also
+// builds the program, the batch endpoint and sessions
+const C_CHECK_FLAGS = ['-Wall', '-pedantic'];
+
+// Linked into every C program built to run: turns crashes into readable
+// messages. It is a separate object, compiled once with the flags C
+// programs used to be built with, so that the submission itself compiles
+// exactly as its syntax check does and may declare POSIX names of its own.
+const C_RUNTIME_SOURCE = `#include <signal.h>
+#include <unistd.h>
+
+static void syntax_checker_signal_handler(int signal_num) {
+    static const char segv[] = "Segmentation fault (accessing invalid memory)\\n";
+    static const char fpe[] = "Floating point exception (division by zero)\\n";
+    static const char abrt[] = "Aborted (assertion failed or abort() called)\\n";
+    switch (signal_num) {
+        case SIGSEGV: (void) !write(2, segv, sizeof segv - 1); break;
+        case SIGFPE: (void) !write(2, fpe, sizeof fpe - 1); break;
+        case SIGABRT: (void) !write(2, abrt, sizeof abrt - 1); break;
+    }
+    _exit(1);
+}
+
+__attribute__((constructor)) static void syntax_checker_install_signal_handlers(void) {
+    signal(SIGSEGV, syntax_checker_signal_handler);
+    signal(SIGFPE, syntax_checker_signal_handler);
+    signal(SIGABRT, syntax_checker_signal_handler);
+}
+`;
+const C_RUNTIME_FLAGS = ['-std=c17', '-Wall', '-Wextra'];
+
+// The runtime object's path in the temp dir, built on first use. Its name
+// carries a hash of the source and flags, and it is renamed into place, so
+// processes sharing the temp dir can build it at once.
+let cRuntimeObject = null;
+function cRuntime() {
+    if (!cRuntimeObject) {
+        cRuntimeObject = (async () => {
+            const hash = crypto.createHash('sha256').update(JSON.stringify([C_RUNTIME_FLAGS, C_RUNTIME_SOURCE])).digest('hex');
+            const file = path.join(tempDir, `c_runtime_${hash.slice(0, 16)}.o`);
+            try {
+                await fs.access(file);
+                return file;
+            } catch (error) {
+                // not built yet
+            }
+            const partial = `${file}.${process.pid}.${Date.now()}`;
+            try {
+                await compilerPool.run(['gcc', ...C_RUNTIME_FLAGS, '-c', '-x', 'c', '-', '-o', compilerPool.pathFor(partial)], {
+                    timeout: COMPILE_TIMEOUT, input: C_RUNTIME_SOURCE
+                });
+                await fs.rename(partial, file);
+                return file;
+            } finally {
+                await cleanupTempFile(partial);
+            }
+        })();
+        cRuntimeObject.catch(() => {
+            cRuntimeObject = null;
+        });
+    }
+    return cRuntimeObject;
+}
+
+// Headers and `using namespace std;` injected in front of every C++ submission
+const CPP_PRELUDE_FILE = 'cpp_prelude.hpp';
+const CPP_PRELUDE = require('fs').readFileSync(path.join(__dirname, CPP_PRELUDE_FILE), 'utf8');
+const CPP_PRELUDE_LINES = CPP_PCH_DIR ? 0 : CPP_PRELUDE.split('\n').length - 1;
+
+// With CPP_PCH_DIR set the prelude is not prepended as text: g++ is pointed
+// at ${CPP_PCH_DIR}/<std>/cpp_prelude.hpp with -include and loads the .gch
+// next to it (see Dockerfile.cpp), so the headers are never reparsed.
+function cppSource(code) {
+    return CPP_PCH_DIR ? code : CPP_PRELUDE + code;
+}
+
+function cppPreludeArgs(std) {
+    if (!CPP_PCH_DIR) {
+        return [];
+    }
+    return ['-include', path.posix.join(CPP_PCH_DIR, std, CPP_PRELUDE_FILE), '-Winvalid-pch'];
+}
+
+// Native pre-checker for C and C++ (precheck.cc, built through binding.gyp
+// on npm install). Without the addon every submission goes to the compiler.
+const nativePrecheck = (() => {
     try {
-        // Process the code to ensure proper structure
-        let processedCode = code;
-        
-        // Add necessary headers
-        let headers = '';
-        headers += '#include <iostream>\n';
-        headers += '#include <stdexcept>\n';
-        headers += '#include <string>\n';
-        headers += '#include <vector>\n';
-        headers += '#include <algorithm>\n';
-        headers += '#include <memory>\n';
-        headers += '#include <cstdlib>\n';
-        headers += '#include <cstring>\n';
-        headers += '#include <cctype>\n';
-        headers += '#include <cmath>\n\n';
-        
-        // Add namespace
-        headers += 'using namespace std;\n\n';
-        
-        // Write the code to a temporary file
-        const finalCode = headers + processedCode;
-        debugLog('Writing code to file:', finalCode);
-        await fs.writeFile(cppFile, finalCode, 'utf8');
-        
-        // Get absolute paths for Docker volume mounting
-        const absoluteTempDir = path.resolve(tempDir);
-        const relativeFilePath = path.basename(cppFile);
-        const relativeExecPath = path.basename(execFile);
-        
-        // Create a Docker container for compilation and execution
-        debugLog('Compiling and running C++ code...');
-        
-        // First, create a Dockerfile
-        const dockerfilePath = path.join(tempDir, `Dockerfile_${timestamp}`);
-        const dockerfileContent = `FROM ${DOCKER_CPP_IMAGE}
-WORKDIR /workspace
-COPY ${relativeFilePath} .
-RUN g++ -Wall -Wextra -std=c++20 ${relativeFilePath} -o ${relativeExecPath}
-CMD ["./program_${timestamp}"]`;
-        
-        await fs.writeFile(dockerfilePath, dockerfileContent);
-        
-        // Build and run the Docker container
-        try {
-            // Build the container
-            const buildCmd = `docker build -t cpp_program_${timestamp} -f "${dockerfilePath}" "${absoluteTempDir}"`;
-            debugLog('Build command:', buildCmd);
-            
-            const { stdout: buildStdout, stderr: buildStderr } = await executeWithTimeout(buildCmd, COMPILE_TIMEOUT);
-            
-            if (buildStderr) {
-                // Process compilation errors to make them more readable
-                const errorLines = buildStderr.split('\n');
-                const errors = [];
-                let mainError = '';
-                
-                for (const line of errorLines) {
-                    const match = line.match(/(.*?):(\d+):(\d+):\s*(warning|error):\s*(.*)/);
-                    if (match) {
-                        const [_, file, lineNum, col, type, msg] = match;
-                        
-                        if (type === 'error' && !mainError) {
-                            mainError = msg;
-                        }
+        return require('./build/Release/precheck.node');
+    } catch (error) {
+        debugLog('Native pre-checker unavailable:', error.message);
+        return null;
+    }
+})();
 
-                        // Adjust line numbers to account for added headers
-                        const adjustedLineNum = parseInt(lineNum) - headers.split('\n').length + 1;
+// The invalid result for C or C++ code the pre-checker can already reject
+// (unbalanced delimiters, an unterminated literal or comment), or null.
+// It runs before a check is admitted, so such code never waits for or
+// occupies a compiler worker.
+function precheckSyntax(language, code) {
+    if (!nativePrecheck || (language !== 'c' && language !== 'cpp')) {
+        return null;
+    }
+    const finding = nativePrecheck.precheck(code, language);
+    return finding && precheckFailure(language, finding);
+}
 
-                        errors.push({
-                            line: Math.max(1, adjustedLineNum),
-                            column: parseInt(col),
-                            type: type,
-                            message: msg.trim(),
-                            suggestion: getSuggestionForError(msg)
-                        });
-                    }
-                }
-                
-                return { 
-                    success: false, 
-                    output: null, 
-                    error: mainError || 'Compilation failed',
-                    errors: errors
-                };
+// precheckSyntax over many { language, code } items, with one native call
+// per language. Returns an array of results in the same order.
+function precheckSyntaxBatch(items) {
+    const results = items.map(() => null);
+    if (!nativePrecheck) {
+        return results;
+    }
+    for (const language of ['c', 'cpp']) {
+        const indices = items.flatMap((item, i) => item.language === language ? [i] : []);
+        if (indices.length === 0) {
+            continue;
+        }
+        const findings = nativePrecheck.precheckBatch(indices.map(i => items[i].code), language);
+        indices.forEach((index, j) => {
+            if (findings[j]) {
+                results[index] = precheckFailure(language, findings[j]);
             }
-            
-            // Run the container
-            const runCmd = `docker run --rm cpp_program_${timestamp}`;
-            debugLog('Run command:', runCmd);
-            
-            const { stdout, stderr } = await executeWithTimeout(runCmd, EXECUTION_TIMEOUT);
-            
-            return { 
-                success: true, 
-                output: stdout, 
-                error: stderr || null 
-            };
-        } catch (error) {
-            debugLog('Docker error:', error);
-            return { 
-                success: false, 
-                output: null, 
-                error: error.message.includes('timed out') ? 
-                    'Execution timed out. Your code took too long to run.' : 
-                    error.message 
-            };
-        } finally {
-            // Cleanup Docker resources
+        });
+    }
+    return results;
+}
+
+// The invalid result for a pre-checker finding
+function precheckFailure(language, finding) {
+    const point = ({ line, column }) => ({ file: SOURCE_LABEL, line, column });
+    const stream = new DiagnosticStream({ format: 'json', limit: MAX_DIAGNOSTICS });
+    stream.add({
+        kind: 'error',
+        ...point(finding),
+        message: finding.message,
+        ranges: [{ start: point(finding), finish: point(finding) }],
+        fixits: [],
+        children: finding.note
+            ? [{ kind: 'note', ...point(finding.note), message: finding.note.message, ranges: [], fixits: [], children: [] }]
+            : []
+    });
+    return language === 'cpp' ? cppSyntaxFailure(stream, null, 0) : cSyntaxFailure(stream);
+}
+
+// Syntax checkers and executors by normalized language
+const SYNTAX_CHECKERS = {
+    javascript: code => jsWorkerPool.check(code),
+    python: checkPythonSyntax,
+    java: checkJavaSyntax,
+    cpp: checkCPPSyntax, // For C++, use the code as-is without any wrapping
+    c: checkCSyntax
+};
+
+const CHECK_AND_RUN = {
+    java: checkAndRunJava,
+    cpp: checkAndRunCPP,
+    c: checkAndRunC
+};
+
+const EXECUTORS = {
+    javascript: executeJavaScript,
+    python: executePython,
+    java: executeJava,
+    cpp: executeCPP,
+    c: executeC
+};
+
+// Content-addressed cache of syntax check results. The in-process tier is an
+// LRU over a Map (insertion order doubles as recency order). With
+// RESULT_CACHE_DIR set, entries are also written as one JSON file per key to
+// that directory, so instances sharing a volume share their hits.
+class ResultCache {
+    constructor({ maxEntries, dir }) {
+        this.maxEntries = maxEntries;
+        this.dir = dir;
+        this.entries = new Map();
+        this.hits = 0;
+        this.sharedHits = 0;
+        this.misses = 0;
+    }
+
+    filePath(key) {
+        return path.join(this.dir, key.slice(0, 2), `${key}.json`);
+    }
+
+    remember(key, value) {
+        this.entries.delete(key);
+        this.entries.set(key, value);
+        if (this.entries.size > this.maxEntries) {
+            this.entries.delete(this.entries.keys().next().value);
+        }
+    }
+
+    async get(key) {
+        if (this.entries.has(key)) {
+            const value = this.entries.get(key);
+            this.remember(key, value);
+            this.hits++;
+            return value;
+        }
+        if (this.dir) {
             try {
-                await execAsync(`docker rmi cpp_program_${timestamp}`);
-            } catch (e) {
-                debugLog('Error cleaning up Docker image:', e);
+                const value = JSON.parse(await fs.readFile(this.filePath(key), 'utf8'));
+                this.remember(key, value);
+                this.sharedHits++;
+                return value;
+            } catch (error) {
+                if (error.code !== 'ENOENT') {
+                    debugLog('Error reading shared cache entry:', error.message);
+                }
             }
         }
-    } catch (error) {
-        debugLog('C++ execution error:', error);
-        return { 
-            success: false, 
-            output: null, 
-            error: error.message.includes('timed out') ? 
-                'Execution timed out. Your code took too long to run.' : 
-                error.message 
+        this.misses++;
+        return null;
+    }
+
+    async set(key, value) {
+        this.remember(key, value);
+        if (!this.dir) {
+            return;
+        }
+        // Write to a private name first so readers never see a partial file
+        const file = this.filePath(key);
+        const partial = `${file}.${process.pid}.${Date.now()}`;
+        try {
+            await fs.mkdir(path.dirname(file), { recursive: true });
+            await fs.writeFile(partial, JSON.stringify(value));
+            await fs.rename(partial, file);
+        } catch (error) {
+            debugLog('Error writing shared cache entry:', error.message);
+            await cleanupTempFile(partial);
+        }
+    }
+
+    stats() {
+        const lookups = this.hits + this.sharedHits + this.misses;
+        return {
+            entries: this.entries.size,
+            hits: this.hits,
+            sharedHits: this.sharedHits,
+            misses: this.misses,
+            hitRate: lookups ? (this.hits + this.sharedHits) / lookups : 0
         };
-    } finally {
-        await cleanupTempFile(cppFile);
-        await cleanupTempFile(execFile);
-        await cleanupTempFile(path.join(tempDir, `Dockerfile_${timestamp}`));
     }
 }
 
-// Function to execute C code
-async function executeC(code) {
-    const cFile = path.join(tempDir, `program_${Date.now()}.c`);
-    const execFile = path.join(tempDir, `program_${Date.now()}`);
-    try {
-        // Add error handling code
-        const wrappedCode = `
-#include <stdio.h>
-#include <stdlib.h>
-#include <signal.h>
-#include <string.h>
+const resultCache = IS_WORKER ? new ResultCacheClient() : new ResultCache({ maxEntries: RESULT_CACHE_SIZE, dir: RESULT_CACHE_DIR });
 
-void signal_handler(int signal_num) {
-    switch (signal_num) {
-        case SIGSEGV:
-            fprintf(stderr, "Segmentation fault (accessing invalid memory)\\n");
-            exit(1);
-        case SIGFPE:
-            fprintf(stderr, "Floating point exception (division by zero)\\n");
-            exit(1);
-        case SIGABRT:
-            fprintf(stderr, "Aborted (assertion failed or abort() called)\\n");
-            exit(1);
+// Everything besides the code that decides a language's syntax verdict
+const SYNTAX_CHECK_CONFIG = {
+    javascript: () => 'babel-parser module+script jsx typescript decorators',
+    python: () => 'python_worker.py compile()',
+    java: () => 'JavaCheckService javax.tools -proc:none',
+    cpp: () => `g++ -fsyntax-only -Wall -Wextra -x c++ - detect=${CPP_STANDARD_DETECTION} pch=${CPP_PCH_DIR} diagnostics=${CPP_DIAGNOSTICS_FORMAT}/${MAX_DIAGNOSTICS}\n${CPP_PRELUDE}`,
+    c: () => `gcc -fsyntax-only ${C_CHECK_FLAGS.join(' ')} -x c - diagnostics=${CPP_DIAGNOSTICS_FORMAT}/${MAX_DIAGNOSTICS}`
+};
+
+// Identifies the toolchain behind each language, so that upgrading a
+// compiler image (or the host compiler) invalidates old entries.
+const toolchainIds = {};
+function toolchainId(language) {
+    if (!toolchainIds[language]) {
+        toolchainIds[language] = resolveToolchainId(language).catch(() => 'unknown');
     }
+    return toolchainIds[language];
 }
 
-int main() {
-    signal(SIGSEGV, signal_handler);
-    signal(SIGFPE, signal_handler);
-    signal(SIGABRT, signal_handler);
-    ${code.includes('main()') ? code.replace(/int\s+main\s*\([^)]*\)\s*{/, '').slice(0, -1) : code}
-    return 0;
-}`;
-        
-        await fs.writeFile(cFile, wrappedCode);
-        
-        // Compile C code with timeout and all warnings
-        debugLog('Compiling C code...');
-        await executeWithTimeout(
-            `docker run --rm -v "${tempDir}:/code" -w /code ${DOCKER_C_IMAGE} gcc -Wall -Wextra -std=c17 /code/$(basename "${cFile}") -o /code/$(basename "${execFile}")`,
-            COMPILE_TIMEOUT
-        );
-        
-        // Run C code with timeout
-        debugLog('Running C code...');
-        const { stdout, stderr } = await executeWithTimeout(
-            `docker run --rm -v "${tempDir}:/code" -w /code ${DOCKER_C_IMAGE} /code/$(basename "${execFile}")`,
-            EXECUTION_TIMEOUT
-        );
-        
-        return { success: stderr ? false : true, output: stdout, error: stderr || null };
-    } catch (error) {
-        debugLog('C execution error:', error);
-        return { 
-            success: false, 
-            output: null, 
-            error: error.message.includes('timed out') ? 
-                'Execution timed out. Your code took too long to run.' : 
-                error.message 
-        };
-    } finally {
-        await cleanupTempFile(cFile);
-        await cleanupTempFile(execFile);
+async function resolveToolchainId(language) {
+    const dockerImageId = async image => (await runFile('docker', ['image', 'inspect', '--format', '{{.Id}}', image])).stdout.trim();
+    switch (language) {
+        case 'javascript':
+            return `@babel/parser@${require('@babel/parser/package.json').version}`;
+        case 'python':
+            return (await runFile('/usr/bin/python3', ['--version'])).stdout.trim();
+        case 'java':
+            return COMPILER_SANDBOX === 'none'
+                ? (await runFile('java', ['-version'])).stderr.split('\n')[0]
+                : dockerImageId(DOCKER_JAVA_IMAGE);
+        case 'cpp':
+            return COMPILER_SANDBOX === 'none'
+                ? (await runFile('g++', ['--version'])).stdout.split('\n')[0]
+                : dockerImageId(DOCKER_CPP_IMAGE);
+        case 'c':
+            return COMPILER_SANDBOX === 'none'
+                ? (await runFile('gcc', ['--version'])).stdout.split('\n')[0]
+                : dockerImageId(DOCKER_CPP_IMAGE);
+        default:
+            return 'unknown';
+    }
+}
+
+async function syntaxCacheKey(language, code) {
+    return crypto.createHash('sha256')
+        .update(JSON.stringify([language, await toolchainId(language), SYNTAX_CHECK_CONFIG[language](), code]))
+        .digest('hex');
+}
+
+// Only cache verdicts the compiler actually produced: a valid result, or one
+// that carries diagnostics. Failures without any (docker unreachable, a
+// timeout, a crashed checker) may well succeed on retry.
+function isCacheableResult(language, result) {
+    if (result.retryable) {
+        return false;
+    }
+    if (result.valid || language === 'javascript') {
+        return true;
+    }
+    return Boolean((result.errors && result.errors.length) || (result.details && result.details.length));
+}
+
+// Ensure code is a string and handle any potential encoding issues
+function decodeSubmittedCode(code) {
+    try {
+        return decodeURIComponent(code);
+    } catch (e) {
+        // If decoding fails, use the original code
+        return String(code);
+    }
+}
+
+// The syntax part of a /check-syntax response
+function syntaxResponse(syntaxResult, language, normalizedLang) {
+    return {
+        valid: syntaxResult.valid,
+        message: syntaxResult.message,
+        error: syntaxResult.error,
+        details: syntaxResult.details,
+        errors: syntaxResult.errors,
+        standard: syntaxResult.standard,
+        truncated: syntaxResult.truncated,
+        language: {
+            requested: language,
+            normalized: normalizedLang
+        }
+    };
+}
+
+// The execution part of a /check-syntax response
+function executionResponse(executionResult) {
+    return {
+        success: executionResult.success,
+        output: executionResult.success ? executionResult.output : null,
+        error: executionResult.success ? null : executionResult.error
+    };
+}
+
+// A /check-syntax response sent as server-sent events, for clients that ask
+// for text/event-stream: `syntax` once the verdict is known, `stdout` and
+// `stderr` (each a JSON string) as the program writes them, then `result`
+// with the whole response as a JSON request would have had it, or `error`.
+class EventStream {
+    constructor(res) {
+        this.res = res;
+        res.status(200).set({
+            'Content-Type': 'text/event-stream',
+            'Cache-Control': 'no-cache',
+            'X-Accel-Buffering': 'no'
+        });
+        res.flushHeaders();
+    }
+
+    send(event, data) {
+        if (!this.res.writableEnded) {
+            this.res.write(`event: ${event}\ndata: ${JSON.stringify(data)}\n\n`);
+        }
+    }
+
+    end(event, data) {
+        this.send(event, data);
+        this.res.end();
     }
 }
 
@@ -546,13 +2293,9 @@ app.post('/check-syntax', authenticateRequest, async (req, res) => {
         });
     }
 
-    // Ensure code is a string and handle any potential encoding issues
-    try {
-        code = decodeURIComponent(code);
-    } catch (e) {
-        // If decoding fails, use the original code
-        code = String(code);
-    }
+    const decodeStarted = performance.now();
+    code = decodeSubmittedCode(code);
+    const decodeSeconds = (performance.now() - decodeStarted) / 1000;
 
     const normalizedLang = normalizeLanguage(language);
     if (!normalizedLang) {
@@ -560,81 +2303,294 @@ app.post('/check-syntax', authenticateRequest, async (req, res) => {
             error: 'Unsupported language' 
         });
     }
+    observeStage('json_decode', req.jsonDecodeSeconds || 0, { language: normalizedLang });
+    observeStage('uri_decode', decodeSeconds, { language: normalizedLang });
 
-    try {
-        let syntaxResult;
-        let executionResult = null;
+    const streaming = req.accepts(['application/json', 'text/event-stream']) === 'text/event-stream';
+    // A client that goes away stops its program
+    const abort = new AbortController();
+    res.on('close', () => abort.abort());
 
-        // First check syntax
-        switch (normalizedLang) {
-            case 'javascript':
-                syntaxResult = checkJavaScriptSyntax(code);
-                if (syntaxResult.valid) {
-                    executionResult = await executeJavaScript(code);
-                }
-                break;
-            case 'python':
-                syntaxResult = await checkPythonSyntax(code);
-                if (syntaxResult.valid) {
-                    executionResult = await executePython(code);
-                }
-                break;
-            case 'java':
-                syntaxResult = await checkJavaSyntax(code);
-                if (syntaxResult.valid) {
-                    executionResult = await executeJava(code);
+    await requestContext.run({ language: normalizedLang }, async () => {
+        let release = () => {};
+        let events = null;
+        try {
+            // First check syntax, answering from the result cache when possible.
+            // C and C++ are checked and built by one compiler run.
+            const cacheKey = await syntaxCacheKey(normalizedLang, code);
+            let syntaxResult = await timeStage('cache_lookup', () => resultCache.get(cacheKey));
+            let executionResult = null;
+            res.set('X-Cache', syntaxResult ? 'HIT' : 'MISS');
+            if (!syntaxResult) {
+                syntaxResult = await timeStage('precheck', () => precheckSyntax(normalizedLang, code));
+            }
+
+            // Anything that will run a checker or the program waits its turn
+            if (!syntaxResult || syntaxResult.valid) {
+                release = await timeStage('admission', () => scheduler.admit(normalizedLang, req.apiKey));
+            }
+
+            // Once admitted, a streamed response starts: the verdict goes out
+            // as soon as it is known and the output as it is written
+            let announced = false;
+            const announce = result => {
+                if (events && !announced) {
+                    announced = true;
+                    events.send('syntax', syntaxResponse(result, language, normalizedLang));
                 }
-                break;
-            case 'cpp':
-                // For C++, use the code as-is without any wrapping
-                syntaxResult = await checkCPPSyntax(code);
-                if (syntaxResult.valid) {
-                    executionResult = await executeCPP(code);
+            };
+            const runOptions = { signal: abort.signal };
+            if (streaming) {
+                events = new EventStream(res);
+                runOptions.onOutput = (stream, text) => events.send(stream, text);
+            }
+
+            // Checking and running are one stage where one call does both
+            const fused = Boolean(CHECK_AND_RUN[normalizedLang]);
+            if (!syntaxResult) {
+                const started = performance.now();
+                if (fused) {
+                    ({ syntaxResult, executionResult } = await CHECK_AND_RUN[normalizedLang](code, { ...runOptions, onChecked: announce }));
+                } else {
+                    syntaxResult = await SYNTAX_CHECKERS[normalizedLang](code);
                 }
-                break;
-            case 'c':
-                syntaxResult = await checkCSyntax(code);
-                if (syntaxResult.valid) {
-                    executionResult = await executeC(code);
+                observeStage(fused ? 'check_and_run' : 'check', (performance.now() - started) / 1000, { standard: standardLabel(syntaxResult) });
+                if (isCacheableResult(normalizedLang, syntaxResult)) {
+                    await resultCache.set(cacheKey, syntaxResult);
                 }
-                break;
-            default:
-                return res.status(400).json({ error: 'Unsupported language' });
+            }
+            announce(syntaxResult);
+
+            // Programs may be nondeterministic, so execution always runs
+            if (syntaxResult.valid && !executionResult) {
+                executionResult = await timeStage(fused ? 'check_and_run' : 'execute',
+                    () => EXECUTORS[normalizedLang](code, runOptions), { standard: standardLabel(syntaxResult) });
+            }
+
+            // Prepare the response
+            const response = syntaxResponse(syntaxResult, language, normalizedLang);
+
+            // Add execution result if syntax was valid
+            if (syntaxResult.valid && executionResult) {
+                response.execution = executionResponse(executionResult);
+            }
+
+            await timeStage('response', () => events ? events.end('result', response) : res.json(response),
+                { standard: standardLabel(syntaxResult) });
+        } catch (error) {
+            if (error instanceof AdmissionError) {
+                res.set('Retry-After', String(error.retryAfter));
+                return res.status(429).json({ 
+                    error: error.message,
+                    retryAfter: error.retryAfter 
+                });
+            }
+            console.error('Error processing request:', error);
+            const failure = { 
+                error: 'Internal server error',
+                details: error.message 
+            };
+            if (events) {
+                events.end('error', failure);
+            } else {
+                res.status(500).json(failure);
+            }
+        } finally {
+            release();
+        }
+    });
+});
+
+
+// Run task() for every item, at most `limit` at a time, in order of arrival.
+// A failing task does not stop the others: the first failure is rethrown
+// once every task has finished.
+async function forEachLimited(items, limit, task) {
+    let next = 0;
+    const failures = [];
+    const runners = Array.from({ length: Math.min(limit, items.length) }, async () => {
+        while (next < items.length) {
+            try {
+                await task(items[next++]);
+            } catch (error) {
+                failures.push(error);
+            }
+        }
+    });
+    await Promise.all(runners);
+    if (failures.length) {
+        throw failures[0];
+    }
+}
+
+// Check many submissions in one request: POST an array of
+// { language, code, id? } (or { submissions: [...] }) and read back one
+// NDJSON line per submission, in the order they finish. Identical inputs
+// are checked once, cached verdicts are answered first, and C/C++ misses
+// are checked BATCH_TU_PER_COMPILE translation units per compiler run.
+// Only syntax is checked; nothing is executed.
+app.post('/check-syntax/batch', authenticateRequest, express.json({ limit: MAX_BATCH_SIZE }), async (req, res) => {
+    const submissions = Array.isArray(req.body) ? req.body : req.body && req.body.submissions;
+    if (!Array.isArray(submissions) || submissions.length === 0) {
+        return res.status(400).json({ 
+            error: 'An array of { language, code } submissions is required' 
+        });
+    }
+    if (submissions.length > BATCH_MAX_SUBMISSIONS) {
+        return res.status(413).json({ 
+            error: `A batch may hold at most ${BATCH_MAX_SUBMISSIONS} submissions` 
+        });
+    }
+
+    res.status(200).type('application/x-ndjson');
+    const writeLine = (index, body) => {
+        if (res.writableEnded || res.destroyed) {
+            return;
         }
+        const { id } = submissions[index] || {};
+        res.write(JSON.stringify({ index, ...(id !== undefined ? { id } : {}), ...body }) + '\n');
+    };
 
-        // Prepare the response
-        const response = {
-            valid: syntaxResult.valid,
-            message: syntaxResult.message,
-            error: syntaxResult.error,
-            details: syntaxResult.details,
-            language: {
-                requested: language,
-                normalized: normalizedLang
+    try {
+        // Group identical submissions under their cache key
+        const unique = new Map();
+        await Promise.all(submissions.map(async (submission, index) => {
+            const { code, language } = submission || {};
+            if (!code || !language) {
+                return writeLine(index, { error: 'Both code and language are required' });
+            }
+            const normalizedLang = normalizeLanguage(language);
+            if (!normalizedLang) {
+                return writeLine(index, { error: 'Unsupported language' });
+            }
+            const decoded = decodeSubmittedCode(code);
+            if (decoded.length > MAX_CODE_SIZE) {
+                return writeLine(index, { error: 'Code size exceeds maximum limit' });
+            }
+            const key = await syntaxCacheKey(normalizedLang, decoded);
+            if (!unique.has(key)) {
+                unique.set(key, { key, normalizedLang, code: decoded, entries: [] });
+            }
+            unique.get(key).entries.push({ index, language });
+        }));
+
+        const answered = new Set();
+        const answer = (item, syntaxResult, cached) => {
+            answered.add(item);
+            for (const { index, language } of item.entries) {
+                writeLine(index, { ...syntaxResponse(syntaxResult, language, item.normalizedLang), cached });
             }
         };
 
-        // Add execution result if syntax was valid
-        if (syntaxResult.valid && executionResult) {
-            response.execution = {
-                success: executionResult.success,
-                output: executionResult.success ? executionResult.output : null,
-                error: executionResult.success ? null : executionResult.error
-            };
+        // Cached verdicts, and those the pre-checker reaches in one pass
+        // over the rest, go out straight away; the rest become tasks
+        const items = [...unique.values()];
+        const cachedResults = await Promise.all(items.map(item => resultCache.get(item.key)));
+        const uncached = items.filter((item, i) => !cachedResults[i]);
+        const rejections = precheckSyntaxBatch(uncached.map(item => ({ language: item.normalizedLang, code: item.code })));
+        const rejected = new Map(uncached.map((item, i) => [item, rejections[i]]));
+        const misses = [];
+        items.forEach((item, i) => {
+            const cached = cachedResults[i];
+            if (cached || rejected.get(item)) {
+                answer(item, cached || rejected.get(item), Boolean(cached));
+            } else {
+                misses.push(item);
+            }
+        });
+
+        const tasks = [];
+        for (const language of Object.keys(BATCH_COMPILERS)) {
+            const group = misses.filter(item => item.normalizedLang === language);
+            for (let i = 0; i < group.length; i += BATCH_TU_PER_COMPILE) {
+                tasks.push(group.slice(i, i + BATCH_TU_PER_COMPILE));
+            }
         }
+        for (const item of misses) {
+            if (!BATCH_COMPILERS[item.normalizedLang]) {
+                tasks.push([item]);
+            }
+        }
+
+        // A task that fails answers its own unanswered submissions with
+        // the error, so every submission gets a line
+        const runTask = async items => {
+            if (res.destroyed) {
+                return; // the client went away
+            }
+            const language = items[0].normalizedLang;
+            let release;
+            try {
+                // A multi-file compile is still one compiler process
+                release = await scheduler.admit(language, req.apiKey);
+            } catch (error) {
+                if (!(error instanceof AdmissionError)) {
+                    throw error;
+                }
+                for (const item of items) {
+                    for (const { index } of item.entries) {
+                        writeLine(index, { error: error.message, retryAfter: error.retryAfter });
+                    }
+                }
+                return;
+            }
+            let results;
+            try {
+                results = BATCH_COMPILERS[language] && items.length > 1
+                    ? await checkCompiledSyntaxBatch(language, items.map(item => item.code))
+                    : [await SYNTAX_CHECKERS[language](items[0].code)];
+            } finally {
+                release();
+            }
+            for (const [i, item] of items.entries()) {
+                answer(item, results[i], false);
+                if (isCacheableResult(language, results[i])) {
+                    await resultCache.set(item.key, results[i]).catch(error => {
+                        console.error('Error caching batch result:', error);
+                    });
+                }
+            }
+        };
 
-        res.json(response);
+        await forEachLimited(tasks, BATCH_CONCURRENCY, items => requestContext.run({ language: items[0].normalizedLang }, async () => {
+            try {
+                await runTask(items);
+            } catch (error) {
+                console.error('Error checking batch task:', error);
+                for (const item of items.filter(item => !answered.has(item))) {
+                    for (const { index } of item.entries) {
+                        writeLine(index, { error: 'Internal server error', details: error.message });
+                    }
+                }
+            }
+        }));
     } catch (error) {
-        console.error('Error processing request:', error);
-        res.status(500).json({ 
-            error: 'Internal server error',
-            details: error.message 
-        });
+        console.error('Error processing batch:', error);
+        if (!res.writableEnded && !res.destroyed) {
+            res.write(JSON.stringify({ error: 'Internal server error', details: error.message }) + '\n');
+        }
     }
+    res.end();
 });
 
-// JavaScript syntax checker
-function checkJavaScriptSyntax(code) {
+// Turn a python_worker.py reply into the checker's result
+function pythonSyntaxResult(reply) {
+    if (reply.valid) {
+        return { valid: true, message: 'Syntax is valid' };
+    }
+    return {
+        valid: false,
+        error: reply.traceback,
+        details: [{
+            line: reply.line || 1,
+            column: reply.column || 0,
+            message: `${reply.type}: ${reply.message}`
+        }]
+    };
+}
+
+// Python syntax checker
+async function checkPythonSyntax(code) {
     // Check code size
     if (code.length > 1000000) { // 1MB limit
         return {
@@ -643,146 +2599,441 @@ function checkJavaScriptSyntax(code) {
         };
     }
 
+    return pythonWorkerPool.check(code);
+}
+
+// Turn a JavaCheckService reply into the checker's result
+function javaSyntaxResult(reply) {
+    if (reply.valid) {
+        return { valid: true, message: 'Syntax is valid' };
+    }
+    const details = reply.diagnostics.map(diagnostic => ({
+        line: diagnostic.line,
+        column: diagnostic.column,
+        type: diagnostic.kind,
+        message: diagnostic.message
+    }));
+    const firstError = details.find(detail => detail.type === 'error');
+    return {
+        valid: false,
+        error: reply.failure || (firstError ? `${firstError.message} (line ${firstError.line})` : 'Compilation failed'),
+        details
+    };
+}
+
+// Function to check Java syntax
+async function checkJavaSyntax(code) {
     try {
-        // First try as a module with all features
+        return javaSyntaxResult(await javaService.request('check', code, COMPILE_TIMEOUT));
+    } catch (error) {
+        if (!javaService.available) {
+            return checkJavaSyntaxInContainer(code);
+        }
+        return { valid: false, error: error.message, retryable: true };
+    }
+}
+
+// Check Java syntax with javac in a one-shot container
+async function checkJavaSyntaxInContainer(code) {
+    return workspace.use(async dir => {
         try {
-            babelParse(code, {
-                sourceType: 'module',
-                allowReturnOutsideFunction: true,
-                allowAwaitOutsideFunction: true,
-                allowSuperOutsideMethod: true,
-                allowUndeclaredExports: true,
-                plugins: [
-                    'jsx',
-                    'typescript',
-                    'classProperties',
-                    'privateClassMethods',
-                    'classStaticBlock',
-                    'nullishCoalescingOperator',
-                    'optionalChaining',
-                    ['decorators', { decoratorsBeforeExport: true }]
-                ]
+            // Extract the public class name from the code if it exists
+            const publicClassMatch = code.match(/public\s+class\s+(\w+)/);
+            const className = publicClassMatch ? publicClassMatch[1] : 'Check';
+            const tempFile = path.join(dir, `${className}.java`);
+
+            await writeTempFile(tempFile, code);
+
+            // Use Docker to compile the Java file
+            await runOneShot(DOCKER_JAVA_IMAGE, ['javac', containerPath(tempFile)], {
+                timeout: COMPILE_TIMEOUT, memory: COMPILER_WORKER_MEMORY, cpus: COMPILER_WORKER_CPUS
             });
             return { valid: true, message: 'Syntax is valid' };
-        } catch (moduleError) {
-            // If module parsing fails, try as script
-            try {
-                babelParse(code, {
-                    sourceType: 'script',
-                    allowReturnOutsideFunction: true,
-                    plugins: [
-                        'jsx',
-                        'typescript',
-                        'decorators-legacy',
-                        'classProperties',
-                        'privateClassMethods',
-                        'classStaticBlock',
-                        'nullishCoalescingOperator',
-                        'optionalChaining',
-                        ['decorators', { decoratorsBeforeExport: true }]
-                    ]
-                });
-                return { valid: true, message: 'Syntax is valid' };
-            } catch (scriptError) {
-                // Return the more relevant error message
-                const error = scriptError.code === 'BABEL_PARSER_SYNTAX_ERROR' ? scriptError : moduleError;
-                return {
-                    valid: false,
-                    error: error.message.split('\n')[0],
-                    line: error.loc?.line || 1,
-                    column: error.loc?.column || 0,
-                    details: {
-                        message: error.message,
-                        type: error.code || 'SyntaxError',
-                        loc: error.loc
+        } catch (error) {
+            return { 
+                valid: false, 
+                error: error.message,
+                details: []
+            };
+        }
+    });
+}
+
+// Incremental reader for gcc/g++ diagnostics, fed stderr chunk by chunk as
+// the compiler writes it. In 'json' mode (-fdiagnostics-format=json) each
+// top-level diagnostic object is cut out of the stream by a small scanner
+// and parsed on its own, so the whole output never has to be split or
+// parsed at once. In 'text' mode (compilers without the JSON format) lines
+// are matched one at a time, and notes and "In file included from" lines
+// are attached to their diagnostic. Only the first `limit` diagnostics are
+// kept: after that the scanner stops and `truncated` is set. Output that is
+// not a diagnostic (linker errors, driver messages) collects in `text`.
+class DiagnosticStream {
+    constructor({ format, limit }) {
+        this.format = format;
+        this.limit = limit;
+        this.diagnostics = [];
+        this.truncated = false;
+        this.text = '';
+        // JSON scanner state
+        this.depth = 0;
+        this.inString = false;
+        this.escaped = false;
+        this.atLineStart = true;
+        this.element = '';
+        // text mode state
+        this.partialLine = '';
+        this.includeChain = [];
+    }
+
+    write(chunk) {
+        if (this.truncated) {
+            return;
+        }
+        if (this.format === 'json') {
+            this.scanJson(chunk);
+        } else {
+            this.scanText(chunk);
+        }
+    }
+
+    end() {
+        if (this.format !== 'json' && this.partialLine) {
+            this.readLine(this.partialLine);
+            this.partialLine = '';
+        }
+    }
+
+    add(diagnostic) {
+        if (this.diagnostics.length >= this.limit) {
+            this.truncated = true;
+            return false;
+        }
+        this.diagnostics.push(diagnostic);
+        return true;
+    }
+
+    addText(text) {
+        if (this.text.length < 65536) {
+            this.text += text;
+        }
+    }
+
+    scanJson(chunk) {
+        let start = this.depth >= 2 ? 0 : -1;
+        let textStart = this.depth === 0 ? 0 : -1;
+        for (let i = 0; i < chunk.length; i++) {
+            const c = chunk.charCodeAt(i);
+            if (this.depth >= 2) {
+                if (this.inString) {
+                    if (this.escaped) {
+                        this.escaped = false;
+                    } else if (c === 0x5c) { // backslash
+                        this.escaped = true;
+                    } else if (c === 0x22) {
+                        this.inString = false;
                     }
-                };
+                } else if (c === 0x22) {
+                    this.inString = true;
+                } else if (c === 0x7b || c === 0x5b) { // { [
+                    this.depth++;
+                } else if ((c === 0x7d || c === 0x5d) && --this.depth === 1) { // } ]
+                    const source = this.element + chunk.slice(start, i + 1);
+                    this.element = '';
+                    start = -1;
+                    if (!this.add(normalizeJsonDiagnostic(JSON.parse(source)))) {
+                        return;
+                    }
+                }
+            } else if (this.depth === 1) {
+                if (c === 0x7b) {
+                    this.depth = 2;
+                    start = i;
+                } else if (c === 0x5d) {
+                    this.depth = 0;
+                    this.atLineStart = false;
+                    textStart = i + 1;
+                }
+            } else if (c === 0x5b && this.atLineStart) {
+                // A diagnostics array starts at the beginning of a line
+                this.addText(chunk.slice(textStart, i));
+                textStart = -1;
+                this.depth = 1;
+            } else {
+                this.atLineStart = c === 0x0a;
             }
         }
-    } catch (error) {
-        return {
-            valid: false,
-            error: error.message,
-            details: {
-                message: error.message,
-                type: 'Error'
+        if (start >= 0) {
+            this.element += chunk.slice(start);
+        }
+        if (textStart >= 0) {
+            this.addText(chunk.slice(textStart));
+        }
+    }
+
+    scanText(chunk) {
+        const lines = (this.partialLine + chunk).split('\n');
+        this.partialLine = lines.pop();
+        for (const line of lines) {
+            if (!this.readLine(line)) {
+                return;
             }
+        }
+    }
+
+    readLine(line) {
+        const included = line.match(/^(?:In file included|\s+) from (.*?):(\d+)(?::(\d+))?[:,]$/);
+        if (included) {
+            this.includeChain.push({ file: included[1], line: parseInt(included[2]), column: parseInt(included[3] || '0') });
+            return true;
+        }
+        const match = line.match(/^(.*?):(\d+):(\d+):\s*(fatal error|error|warning|note):\s*(.*)$/);
+        if (!match) {
+            this.addText(line + '\n');
+            return true;
+        }
+        const [, file, lineNum, col, kind, message] = match;
+        const diagnostic = {
+            kind, file, line: parseInt(lineNum), column: parseInt(col), message: message.trim(),
+            ranges: [], fixits: [], children: [],
+            ...(this.includeChain.length ? { includeChain: this.includeChain } : {})
         };
+        this.includeChain = [];
+        const parent = this.diagnostics[this.diagnostics.length - 1];
+        if (kind === 'note' && parent) {
+            parent.children.push(diagnostic);
+            return true;
+        }
+        return this.add(diagnostic);
+    }
+
+    // Messages and other output, for pattern tests on the whole run
+    summary() {
+        return this.diagnostics.map(diagnostic => diagnostic.message).join('\n') + '\n' + this.text;
     }
 }
 
-// Python syntax checker
-async function checkPythonSyntax(code) {
-    const tempFile = path.join(tempDir, `check_${Date.now()}.py`);
-    
-    try {
-        // Check code size
-        if (code.length > 1000000) { // 1MB limit
-            return {
-                valid: false,
-                error: 'Code size exceeds maximum limit of 1MB'
-            };
-        }
+function normalizeJsonDiagnostic(diagnostic) {
+    const point = location => location && { file: location.file, line: location.line, column: location.column };
+    const locations = diagnostic.locations || [];
+    const caret = (locations[0] && locations[0].caret) || {};
+    return {
+        kind: diagnostic.kind,
+        file: caret.file,
+        line: caret.line || 0,
+        column: caret.column || 0,
+        message: diagnostic.message,
+        ...(diagnostic.option ? { option: diagnostic.option } : {}),
+        ranges: locations.map(location => ({
+            start: point(location.start || location.caret),
+            finish: point(location.finish || location.caret),
+            ...(location.label ? { label: location.label } : {})
+        })),
+        fixits: (diagnostic.fixits || []).map(fixit => ({
+            start: point(fixit.start),
+            next: point(fixit.next),
+            replacement: fixit.string
+        })),
+        children: (diagnostic.children || []).map(normalizeJsonDiagnostic)
+    };
+}
 
-        await fs.writeFile(tempFile, code);
-        
-        try {
-            await execAsync(`/usr/bin/python3 -m py_compile "${tempFile}"`);
-            await cleanupTempFile(tempFile);
-            return { valid: true, message: 'Syntax is valid' };
-        } catch (error) {
-            const errorInfo = {
-                valid: false,
-                error: error.stderr,
-                details: error.stderr.split('\n').map(line => {
-                    const match = line.match(/File ".*", line (\d+)/);
-                    return match ? {
-                        line: parseInt(match[1]),
-                        message: line.trim()
-                    } : null;
-                }).filter(Boolean)
-            };
-            await cleanupTempFile(tempFile);
-            return errorInfo;
+// Every file/line position in a diagnostic, for rewriting them in place
+function* diagnosticPoints(diagnostic) {
+    yield diagnostic;
+    for (const range of diagnostic.ranges) {
+        yield range.start;
+        yield range.finish;
+    }
+    for (const fixit of diagnostic.fixits) {
+        yield fixit.start;
+        yield fixit.next;
+    }
+    for (const entry of diagnostic.includeChain || []) {
+        yield entry;
+    }
+    for (const child of diagnostic.children) {
+        yield* diagnosticPoints(child);
+    }
+}
+
+// Rename a file throughout a diagnostic and shift its lines by -lineOffset
+function relocateDiagnostic(diagnostic, from, to, lineOffset = 0) {
+    for (const point of diagnosticPoints(diagnostic)) {
+        if (point && point.file === from) {
+            point.file = to;
+            point.line = Math.max(1, point.line - lineOffset);
         }
-    } catch (error) {
-        await cleanupTempFile(tempFile);
-        return {
-            valid: false,
-            error: error.message
-        };
     }
+    return diagnostic;
+}
+
+// A diagnostic as one gcc-style text line
+function formatDiagnostic(diagnostic) {
+    return `${diagnostic.file}:${diagnostic.line}:${diagnostic.column}: ${diagnostic.kind}: ${diagnostic.message}`;
+}
+
+// The entry for one diagnostic in a result's `errors`
+function diagnosticEntry(diagnostic, { suggest } = {}) {
+    return {
+        line: diagnostic.line,
+        column: diagnostic.column,
+        type: diagnostic.kind,
+        message: diagnostic.message,
+        ...(suggest ? { suggestion: getSuggestionForError(diagnostic.message) } : {}),
+        ...(diagnostic.file !== SOURCE_LABEL ? { file: diagnostic.file } : {}),
+        ranges: diagnostic.ranges,
+        fixits: diagnostic.fixits,
+        context: diagnostic.children.map(child => ({
+            file: child.file, line: child.line, column: child.column, message: child.message
+        })),
+        ...(diagnostic.includeChain ? { includeChain: diagnostic.includeChain } : {})
+    };
+}
+
+// Name the submission goes by in diagnostics (gcc's name for stdin)
+const SOURCE_LABEL = '<stdin>';
+
+// Whether the compiler understands -fdiagnostics-format=json (GCC 9 to 14).
+// With CPP_DIAGNOSTICS_FORMAT=auto this is probed once with an empty input.
+let diagnosticsFormatPromise = null;
+function diagnosticsFormat() {
+    if (CPP_DIAGNOSTICS_FORMAT !== 'auto') {
+        return Promise.resolve(CPP_DIAGNOSTICS_FORMAT);
+    }
+    if (!diagnosticsFormatPromise) {
+        diagnosticsFormatPromise = compilerPool.run(
+            ['gcc', '-fdiagnostics-format=json', '-fsyntax-only', '-x', 'c', '-'],
+            { timeout: COMPILE_TIMEOUT, input: '' }
+        ).then(() => 'json', error => {
+            if (error.stderr === undefined || error.timedOut) {
+                diagnosticsFormatPromise = null; // the pool is not ready; ask again later
+            }
+            return 'text';
+        });
+    }
+    return diagnosticsFormatPromise;
 }
 
-// Function to check Java syntax
-async function checkJavaSyntax(code) {
+// Run gcc/g++ (argv with the compiler first) in the pool, reading its
+// diagnostics as they stream in. Resolves with { success, error, diagnostics }.
+// Only the stream keeps the diagnostics. In text mode gcc stops one error
+// past what the stream keeps, so that it still sees the list was cut; GCC's
+// JSON output is written at exit and lost when -fmax-errors ends the run,
+// so there the output is read, up to COMPILER_OUTPUT_LIMIT, and dropped.
+async function runCompiler(args, { input, pin } = {}) {
+    const format = await diagnosticsFormat();
+    const diagnostics = new DiagnosticStream({ format, limit: MAX_DIAGNOSTICS });
+    const formatArgs = format === 'json'
+        ? ['-fdiagnostics-format=json']
+        : ['-fdiagnostics-color=never', `-fmax-errors=${MAX_DIAGNOSTICS + 1}`];
+    const fullArgs = [args[0], ...formatArgs, ...args.slice(1)];
+    debugLog('Compiler command:', fullArgs.join(' '));
+    const std = args.find(arg => arg.startsWith('-std='));
+    const labels = { language: args[0] === 'gcc' ? 'c' : 'cpp', standard: std ? std.slice('-std='.length) : '' };
+    const started = performance.now();
     try {
-        // Extract the public class name from the code if it exists
-        const publicClassMatch = code.match(/public\s+class\s+(\w+)/);
-        const className = publicClassMatch ? publicClassMatch[1] : `Check_${Date.now()}`;
-        const tempFile = path.join(tempDir, `${className}.java`);
-        
-        await fs.writeFile(tempFile, code);
-        
-        // Use Docker to compile the Java file
-        await execAsync(`docker run --rm -v "${tempDir}:/code" -w /code openjdk:11 javac /code/$(basename "${tempFile}")`);
-        
-        await cleanupTempFile(tempFile);
-        await cleanupTempFile(tempFile.replace('.java', '.class'));
-        return { valid: true, message: 'Syntax is valid' };
+        await compilerPool.run(fullArgs, {
+            timeout: COMPILE_TIMEOUT,
+            input,
+            pin,
+            maxOutput: COMPILER_OUTPUT_LIMIT,
+            buffer: false,
+            onStderr: chunk => diagnostics.write(chunk)
+        });
+        diagnostics.end();
+        return { success: true, error: null, diagnostics };
     } catch (error) {
-        return { 
-            valid: false, 
-            error: error.message,
-            details: []
-        };
+        diagnostics.end();
+        return { success: false, error, diagnostics };
+    } finally {
+        observeStage('compile', (performance.now() - started) / 1000, labels);
     }
 }
 
-// Enhanced C++ syntax checker
-async function checkCPPSyntax(code) {
-    const tempFile = path.join(tempDir, `check_${Date.now()}.cpp`);
-    
+// C++ standards in order of preference, most modern first
+const CPP_STANDARDS = [
+    { std: 'c++20', name: 'C++20' },
+    { std: 'c++17', name: 'C++17' },
+    { std: 'c++14', name: 'C++14' },
+    { std: 'c++11', name: 'C++11' }
+];
+
+// Diagnostics under -std=c++20 that mean the code relies on something a
+// later standard removed, mapped to the newest standard that still has it.
+const CPP_REMOVED_FEATURES = [
+    { pattern: /ISO C\+\+17 does not allow/, std: 'c++14' },
+    { pattern: /'(auto_ptr|random_shuffle|bind1st|bind2nd|ptr_fun|mem_fun|unary_function|binary_function)' is not a member of 'std'/, std: 'c++14' },
+    { pattern: /ISO C\+\+20 does not allow|'(result_of|is_literal_type)' (is not a member|in namespace)/, std: 'c++17' }
+];
+
+// Parses under one standard, or with `output` builds the executable there.
+// A build that only fails to link still counts as a successful parse.
+async function compileCppWithStandard(source, standard, output) {
+    const args = [
+        'g++', `-std=${standard.std}`, ...(output ? [] : ['-fsyntax-only']), '-Wall', '-Wextra',
+        ...cppPreludeArgs(standard.std), '-x', 'c++', '-',
+        ...(output ? ['-o', compilerPool.pathFor(output)] : [])
+    ];
+    const { success, error, diagnostics } = await runCompiler(args, { input: source });
+    if (success) {
+        return { success: true, standard: standard.name, error: null, diagnostics };
+    }
+    if (output && !diagnostics.diagnostics.length && isLinkFailure(diagnostics.text)) {
+        return { success: true, standard: standard.name, error: null, diagnostics, linkError: diagnostics.text };
+    }
+    return { success: false, standard: standard.name, error, diagnostics };
+}
+
+// One -std=c++20 parse. C++20 accepts nearly all older code, so its verdict
+// stands unless the diagnostics show the code uses a feature C++17/C++20
+// removed; only then is it parsed once more under the standard that still
+// had that feature.
+async function detectCppStandardSinglePass(source, output) {
+    const first = await compileCppWithStandard(source, CPP_STANDARDS[0], output);
+    if (first.success) {
+        return first;
+    }
+    const summary = first.diagnostics.summary();
+    const removed = CPP_REMOVED_FEATURES.find(feature => feature.pattern.test(summary));
+    if (!removed) {
+        return first;
+    }
+    const older = await compileCppWithStandard(source, CPP_STANDARDS.find(s => s.std === removed.std), output);
+    return older.success ? older : first;
+}
+
+// Every standard at once on the worker pool. Resolves with the most modern
+// standard that succeeds as soon as all more modern ones have failed; if
+// none succeeds, reports the first failure that is not about the standard,
+// as the old sequential loop did. With `output`, each standard builds its
+// own executable and the winner's is moved into place.
+async function detectCppStandardParallel(source, output) {
+    const outputs = CPP_STANDARDS.map(standard => output && `${output}.${standard.std}`);
+    const attempts = CPP_STANDARDS.map((standard, i) => compileCppWithStandard(source, standard, outputs[i]));
+    if (output) {
+        Promise.allSettled(attempts).then(() => Promise.all(outputs.map(cleanupTempFile)));
+    }
+    let fallback = null;
+    for (const [i, attempt] of attempts.entries()) {
+        const result = await attempt;
+        if (result.success) {
+            if (output && !result.linkError) {
+                await fs.rename(outputs[i], output);
+            }
+            return result;
+        }
+        if (!fallback && !result.diagnostics.summary().includes('standard')) {
+            fallback = result;
+        }
+    }
+    const last = await attempts[attempts.length - 1];
+    return fallback || { success: false, standard: null, error: last.error, diagnostics: last.diagnostics };
+}
+
+// Enhanced C++ syntax checker. With `output`, a valid program is also built
+// into that path (see checkAndRunCPP).
+async function checkCPPSyntax(code, { output } = {}) {
     try {
         // Check code size
         if (code.length > 1000000) { // 1MB limit
@@ -792,109 +3043,30 @@ async function checkCPPSyntax(code) {
             };
         }
 
-        // Add necessary headers
-        let headers = '';
-        headers += '#include <iostream>\n';
-        headers += '#include <stdexcept>\n';
-        headers += '#include <string>\n';
-        headers += '#include <vector>\n';
-        headers += '#include <algorithm>\n';
-        headers += '#include <memory>\n';
-        headers += '#include <cstdlib>\n';
-        headers += '#include <cstring>\n';
-        headers += '#include <cctype>\n';
-        headers += '#include <cmath>\n\n';
-        
-        // Add namespace
-        headers += 'using namespace std;\n\n';
-        
-        // Write the code to a temporary file
-        const finalCode = headers + code;
-        debugLog('Writing code to file:', finalCode);
-        await fs.writeFile(tempFile, finalCode, 'utf8');
+        // The code (with the prelude unless it is precompiled) is piped to g++
+        const finalCode = cppSource(code);
+        debugLog('Checking code:', finalCode);
         
         try {
-            // Try with different C++ standards in order of most modern to least
-            const standards = [
-                { std: 'c++20', name: 'C++20' },
-                { std: 'c++17', name: 'C++17' },
-                { std: 'c++14', name: 'C++14' },
-                { std: 'c++11', name: 'C++11' }
-            ];
-            
-            let success = false;
-            let lastError = null;
-            let usedStandard = null;
-
-            for (const standard of standards) {
-                try {
-                    const cmd = `docker run --rm -v "${path.dirname(tempFile)}:/workspace" -w /workspace ${DOCKER_CPP_IMAGE} bash -c 'cat /workspace/$(basename "${tempFile}") && g++ -std=${standard.std} -fsyntax-only -Wall -Wextra /workspace/$(basename "${tempFile}")'`;
-                    debugLog('Syntax check command:', cmd);
-                    const { stdout, stderr } = await execAsync(cmd);
-                    success = true;
-                    usedStandard = standard.name;
-                    break;
-                } catch (e) {
-                    // If error doesn't mention C++ standard, this might be the right standard but with other errors
-                    if (!e.stderr.includes('standard')) {
-                        lastError = e;
-                        usedStandard = standard.name;
-                        break;
-                    }
-                    lastError = e;
-                }
-            }
+            const { success, standard: usedStandard, error: lastError, diagnostics, linkError } =
+                CPP_STANDARD_DETECTION === 'parallel'
+                    ? await detectCppStandardParallel(finalCode, output)
+                    : await detectCppStandardSinglePass(finalCode, output);
 
             if (success) {
-                await cleanupTempFile(tempFile);
                 return { 
                     valid: true, 
                     message: 'Syntax is valid',
-                    standard: usedStandard
+                    standard: usedStandard,
+                    ...(linkError ? { linkError } : {})
                 };
             }
 
-            // Process the error for better readability
-            const errorLines = lastError.stderr.split('\n');
-            const errors = [];
-            let mainError = '';
-            
-            for (const line of errorLines) {
-                // Skip standard-related errors as we've tried all standards
-                if (line.includes('standard')) continue;
-                
-                const match = line.match(/(.*?):(\d+):(\d+):\s*(warning|error):\s*(.*)/);
-                if (match) {
-                    const [_, file, lineNum, col, type, msg] = match;
-                    
-                    // Store the first error as main error
-                    if (type === 'error' && !mainError) {
-                        mainError = msg;
-                    }
-
-                    // Adjust line numbers to account for added headers
-                    const adjustedLineNum = parseInt(lineNum) - headers.split('\n').length + 1;
-
-                    errors.push({
-                        line: Math.max(1, adjustedLineNum),
-                        column: parseInt(col),
-                        type: type,
-                        message: msg.trim(),
-                        suggestion: getSuggestionForError(msg)
-                    });
-                }
+            if (!diagnostics.diagnostics.length && !/error/.test(diagnostics.text)) {
+                throw lastError; // not a verdict on the code: a timeout, no compiler...
             }
-            
-            await cleanupTempFile(tempFile);
-            return {
-                valid: false,
-                error: mainError || 'Syntax error in C++ code',
-                errors: errors,
-                standard: usedStandard || 'Unknown',
-                help: 'Make sure your code follows C++ syntax rules and all required headers are included.'
-            };
+            return cppSyntaxFailure(diagnostics, usedStandard);
         } catch (error) {
-            await cleanupTempFile(tempFile);
             return {
                 valid: false,
                 error: error.stderr || error.message,
@@ -903,7 +3075,6 @@ async function checkCPPSyntax(code) {
             };
         }
     } catch (error) {
-        await cleanupTempFile(tempFile);
         return {
             valid: false,
             error: error.message
@@ -911,6 +3082,35 @@ async function checkCPPSyntax(code) {
     }
 }
 
+// Turn g++ diagnostics (a DiagnosticStream) into the checker's invalid result
+function cppSyntaxFailure(stream, usedStandard, lineOffset = CPP_PRELUDE_LINES) {
+    const errors = [];
+    let mainError = '';
+    
+    for (const diagnostic of stream.diagnostics) {
+        // Skip standard-related errors as we've tried all standards
+        if (diagnostic.message.includes('standard')) continue;
+        
+        // Adjust line numbers to account for added headers
+        relocateDiagnostic(diagnostic, SOURCE_LABEL, SOURCE_LABEL, lineOffset);
+
+        // Store the first error as main error
+        if (diagnostic.kind.endsWith('error') && !mainError) {
+            mainError = diagnostic.message;
+        }
+        errors.push(diagnosticEntry(diagnostic, { suggest: true }));
+    }
+    
+    return {
+        valid: false,
+        error: mainError || 'Syntax error in C++ code',
+        errors: errors,
+        ...(stream.truncated ? { truncated: true } : {}),
+        standard: usedStandard || 'Unknown',
+        help: 'Make sure your code follows C++ syntax rules and all required headers are included.'
+    };
+}
+
 // Helper function to provide suggestions for common C++ errors
 function getSuggestionForError(error) {
     if (error.includes('template declaration cannot appear at block scope')) {
@@ -934,66 +3134,740 @@ function getSuggestionForError(error) {
     if (error.includes('local class shall not have static data member')) {
         return 'Move the class definition to global scope and ensure static members are properly declared.';
     }
+    if (error.includes('at end of input') || error.includes('without a matching') || error.includes('unterminated') || error.includes('missing terminating')) {
+        return 'Check that every bracket, brace, parenthesis, quote and comment that is opened is also closed.';
+    }
     return 'Review the syntax and ensure all variables and types are properly declared.';
 }
 
-// C syntax checker
-async function checkCSyntax(code) {
-    const tempFile = path.join(tempDir, `check_${Date.now()}.c`);
-    
+// C syntax checker. With `output`, a valid program is also built into that
+// path, linked with the runtime object (see cRuntime). The submission is
+// compiled alone with C_CHECK_FLAGS either way, so the verdict is the same.
+async function checkCSyntax(code, { output } = {}) {
+    // Check code size
+    if (code.length > 1000000) { // 1MB limit
+        return {
+            valid: false,
+            error: 'Code size exceeds maximum limit of 1MB'
+        };
+    }
+
+    let args = ['gcc', '-fsyntax-only', ...C_CHECK_FLAGS, '-x', 'c', '-'];
+    if (output) {
+        const runtime = await cRuntime().catch(error => {
+            console.error('Error building the C runtime object:', error.message);
+            return null;
+        });
+        args = ['gcc', ...C_CHECK_FLAGS, '-x', 'c', '-', ...(runtime ? ['-x', 'none', compilerPool.pathFor(runtime)] : []),
+            '-o', compilerPool.pathFor(output)];
+    }
+    const { success, error, diagnostics } = await runCompiler(args, { input: code });
+    if (success) {
+        return { valid: true, message: 'Syntax is valid' };
+    }
+    if (output && !diagnostics.diagnostics.length && isLinkFailure(diagnostics.text)) {
+        return { valid: true, message: 'Syntax is valid', linkError: diagnostics.text };
+    }
+    if (!diagnostics.diagnostics.length && !/error/.test(diagnostics.text)) {
+        return {
+            valid: false,
+            error: error.message
+        };
+    }
+    return cSyntaxFailure(diagnostics);
+}
+
+// Turn gcc diagnostics (a DiagnosticStream) into the checker's invalid result
+function cSyntaxFailure(stream) {
+    const lines = stream.diagnostics.map(formatDiagnostic);
+    return {
+        valid: false,
+        error: lines.length ? lines.join('\n') + '\n' : stream.text,
+        errors: stream.diagnostics.map(diagnostic => diagnosticEntry(diagnostic)),
+        ...(stream.truncated ? { truncated: true } : {})
+    };
+}
+
+// Several C or C++ translation units checked by one compiler process: the
+// sources are written to a scratch slot (see WorkspaceRing) and
+// passed to a single -fsyntax-only run, and its diagnostics are assigned
+// back to files by location (relabelled <stdin>, so results match a single
+// check exactly). A diagnostic located in a header belongs to the file its
+// notes lead back to. Any file whose verdict this cannot settle (C++ code
+// needing an older standard, a timeout, diagnostics cut off by the cap or
+// not traceable to a file) is checked again on its own.
+const BATCH_COMPILERS = {
+    cpp: {
+        extension: 'cpp',
+        source: cppSource,
+        args: ['g++', `-std=${CPP_STANDARDS[0].std}`, '-fsyntax-only', '-Wall', '-Wextra', ...cppPreludeArgs(CPP_STANDARDS[0].std)],
+        valid: () => ({ valid: true, message: 'Syntax is valid', standard: CPP_STANDARDS[0].name }),
+        invalid: stream => CPP_REMOVED_FEATURES.some(feature => feature.pattern.test(stream.summary()))
+            ? null
+            : cppSyntaxFailure(stream, CPP_STANDARDS[0].name),
+        single: checkCPPSyntax
+    },
+    c: {
+        extension: 'c',
+        source: code => code,
+        args: ['gcc', '-fsyntax-only', ...C_CHECK_FLAGS],
+        valid: () => ({ valid: true, message: 'Syntax is valid' }),
+        invalid: cSyntaxFailure,
+        single: checkCSyntax
+    }
+};
+
+async function checkCompiledSyntaxBatch(language, codes) {
+    const results = await workspace.use(dir => compileBatchInSlot(language, codes, dir));
+    return Promise.all(results.map((result, i) => result || BATCH_COMPILERS[language].single(codes[i])));
+}
+
+// The verdicts one compiler run over the sources (written into `dir`)
+// settles, with null for the rest
+async function compileBatchInSlot(language, codes, dir) {
+    const compiler = BATCH_COMPILERS[language];
+    const files = codes.map((_, i) => path.join(dir, `${i}.${compiler.extension}`));
+    const results = new Array(codes.length).fill(null);
     try {
-        // Check code size
-        if (code.length > 1000000) { // 1MB limit
-            return {
-                valid: false,
-                error: 'Code size exceeds maximum limit of 1MB'
-            };
-        }
+        await Promise.all(codes.map((code, i) => writeTempFile(files[i], compiler.source(code))));
 
-        await fs.writeFile(tempFile, code);
-        
-        try {
-            const { stdout, stderr } = await execAsync(`gcc -fsyntax-only -Wall -pedantic "${tempFile}"`);
-            await cleanupTempFile(tempFile);
-            return { valid: true, message: 'Syntax is valid' };
-        } catch (error) {
-            const errorLines = error.stderr.split('\n');
-            const errors = [];
-            
-            for (const line of errorLines) {
-                const match = line.match(/(.*?):(\d+):(\d+):\s*(warning|error):\s*(.*)/);
-                if (match) {
-                    errors.push({
-                        line: parseInt(match[2]),
-                        column: parseInt(match[3]),
-                        type: match[4],
-                        message: match[5].trim()
-                    });
+        const jobFiles = files.map(file => compilerPool.pathFor(file));
+        const { success, error, diagnostics } = await runCompiler([...compiler.args, ...jobFiles]);
+        const verdict = success || (!error.timedOut && (diagnostics.diagnostics.length || diagnostics.text));
+        if (verdict) {
+            const perFile = files.map(() => []);
+            let unsettled = diagnostics.truncated;
+            for (const diagnostic of diagnostics.diagnostics) {
+                const points = [...diagnosticPoints(diagnostic)];
+                const i = points.reduce((found, point) => found >= 0 || !point ? found : jobFiles.indexOf(point.file), -1);
+                if (i >= 0) {
+                    perFile[i].push(relocateDiagnostic(diagnostic, jobFiles[i], SOURCE_LABEL));
+                } else if (diagnostic.kind.endsWith('error')) {
+                    unsettled = true;
                 }
             }
-            
-            await cleanupTempFile(tempFile);
-            return {
-                valid: false,
-                error: error.stderr,
-                errors: errors
-            };
+            if (/error/i.test(diagnostics.text)) {
+                unsettled = true; // e.g. a driver error naming no file
+            }
+            perFile.forEach((fileDiagnostics, i) => {
+                if (fileDiagnostics.some(diagnostic => diagnostic.kind.endsWith('error'))) {
+                    const stream = new DiagnosticStream({ format: diagnostics.format, limit: MAX_DIAGNOSTICS });
+                    fileDiagnostics.forEach(diagnostic => stream.add(diagnostic));
+                    results[i] = compiler.invalid(stream);
+                } else if (!unsettled) {
+                    results[i] = compiler.valid();
+                }
+            });
         }
     } catch (error) {
-        await cleanupTempFile(tempFile);
+        debugLog('Batch compile error:', error.message);
+    }
+    return results;
+}
+
+// Editor sessions: the server keeps each session's latest text, so an
+// editor sends only its edits and gets the diagnostics for the result.
+// Sessions expire after SESSION_TTL ms without a request; past
+// SESSION_LIMIT the least recently used one is closed. The interface is
+// asynchronous so the store may live elsewhere.
+class SessionStore {
+    constructor({ ttl, limit, onClose }) {
+        this.ttl = ttl;
+        this.limit = limit;
+        this.onClose = onClose;
+        this.sessions = new Map(); // insertion order doubles as recency order
+        this.sweeper = setInterval(() => this.sweep(), Math.max(1000, Math.floor(ttl / 2)));
+        this.sweeper.unref();
+    }
+
+    async create(session) {
+        while (this.sessions.size >= this.limit) {
+            await this.delete(this.sessions.keys().next().value);
+        }
+        session.touchedAt = Date.now();
+        this.sessions.set(session.id, session);
+        return session;
+    }
+
+    async get(id) {
+        const session = this.sessions.get(id);
+        if (!session) {
+            return null;
+        }
+        this.sessions.delete(id);
+        session.touchedAt = Date.now();
+        this.sessions.set(id, session);
+        return session;
+    }
+
+    async delete(id) {
+        const session = this.sessions.get(id);
+        if (!session) {
+            return false;
+        }
+        this.sessions.delete(id);
+        await this.onClose(session);
+        return true;
+    }
+
+    sweep() {
+        const expired = Date.now() - this.ttl;
+        for (const [id, session] of this.sessions) {
+            if (session.touchedAt > expired) {
+                break; // the rest were touched more recently
+            }
+            this.delete(id).catch(error => console.error('Error closing session:', error));
+        }
+    }
+
+    stats() {
+        return { sessions: this.sessions.size, limit: this.limit };
+    }
+}
+
+const sessionStore = new SessionStore({ ttl: SESSION_TTL, limit: SESSION_LIMIT, onClose: closeSession });
+
+async function closeSession(session) {
+    session.closed = true;
+    if (session.preamble) {
+        session.preamble.stale = true;
+    }
+    await fs.rm(session.dir, { recursive: true, force: true });
+}
+
+// Apply edits ({ start, end, text }, offsets in UTF-16 code units as JS
+// strings count them) one after another, each against the text the
+// previous one left. Returns null if any edit is out of range.
+function applyEdits(code, edits) {
+    for (const edit of edits) {
+        const { start, end = start, text = '' } = edit || {};
+        if (!Number.isInteger(start) || !Number.isInteger(end) || start < 0 || end < start || end > code.length || typeof text !== 'string') {
+            return null;
+        }
+        code = code.slice(0, start) + text + code.slice(end);
+    }
+    return code;
+}
+
+// The leading lines clangd would call the preamble: #include, #import,
+// #define and #pragma lines, using-directives, line comments and blank
+// lines, up to the first line that is anything else. Only whole lines
+// count, and a directive continued with a backslash ends it.
+const PREAMBLE_LINE = /^[ \t]*(#[ \t]*(include|import|define|pragma)\b.*|using[ \t]+namespace[ \t]+[\w:]+[ \t]*;[ \t]*|\/\/.*)?\r?$/;
+
+function splitPreamble(code) {
+    let length = 0;
+    let lines = 0;
+    let directives = 0;
+    for (;;) {
+        const newline = code.indexOf('\n', length);
+        if (newline < 0) {
+            break;
+        }
+        const line = code.slice(length, newline);
+        if (!PREAMBLE_LINE.test(line) || line.endsWith('\\')) {
+            break;
+        }
+        if (line.trim() && !line.trim().startsWith('//')) {
+            directives++;
+        }
+        length = newline + 1;
+        lines++;
+    }
+    return directives ? { preamble: code.slice(0, length), lines, body: code.slice(length) } : null;
+}
+
+// Incremental checking for C and C++: a session's preamble (with the C++
+// prelude in front of it) is compiled once into a PCH in the session's
+// directory, and each edit only parses the rest of the file against it.
+// The body is fed after a #line directive, so its diagnostics carry the
+// submission's own line numbers. Until the PCH for the current preamble
+// (and C++ standard) is built, and whenever its verdict could differ from
+// a full check's, the code gets an ordinary full check.
+const PREAMBLE_COMPILERS = {
+    cpp: {
+        extension: 'hpp',
+        prelude: CPP_PRELUDE,
+        args: std => ['g++', `-std=${std}`, '-Wall', '-Wextra'],
+        header: 'c++-header',
+        source: 'c++',
+        standard: session => CPP_STANDARDS.find(standard => standard.name === session.standard),
+        valid: standard => ({ valid: true, message: 'Syntax is valid', standard: standard.name }),
+        invalid: (stream, standard) => CPP_REMOVED_FEATURES.some(feature => feature.pattern.test(stream.summary()))
+            ? null
+            : cppSyntaxFailure(stream, standard.name, 0)
+    },
+    c: {
+        extension: 'h',
+        prelude: '',
+        args: () => ['gcc', ...C_CHECK_FLAGS],
+        header: 'c-header',
+        source: 'c',
+        standard: () => ({ std: 'default' }),
+        valid: () => ({ valid: true, message: 'Syntax is valid' }),
+        invalid: stream => cSyntaxFailure(stream)
+    }
+};
+
+// The session's PCH for `preamble`, or null while it is being built (the
+// build is started on the first call) or if it failed to build. A PCH is
+// removed once it is replaced and no check is still reading it.
+function sessionPreamble(session, preamble, standard) {
+    const compiler = PREAMBLE_COMPILERS[session.language];
+    const key = `${standard.std}\n${preamble}`;
+    if (session.preamble && session.preamble.key === key) {
+        return session.preamble.header ? session.preamble : null;
+    }
+
+    if (session.preamble) {
+        retirePreamble(session.preamble);
+    }
+    const header = path.join(session.dir, `preamble_${++session.preambleBuilds}.${compiler.extension}`);
+    const pch = { key, header: null, uses: 0, stale: false, files: [header, `${header}.gch`] };
+    session.preamble = pch;
+    (async () => {
+        if (session.closed) {
+            return;
+        }
+        await fs.mkdir(session.dir, { recursive: true });
+        await writeTempFile(header, compiler.prelude + preamble);
+        await compilerPool.run(
+            [...compiler.args(standard.std), '-x', compiler.header, compilerPool.pathFor(header), '-o', compilerPool.pathFor(`${header}.gch`)],
+            { timeout: COMPILE_TIMEOUT, pin: session.pin }
+        );
+        pch.header = header;
+        debugLog(`Session ${session.id} preamble built: ${header}`);
+    })().catch(error => {
+        debugLog(`Session ${session.id} preamble failed:`, error.stderr || error.message);
+    }).finally(() => {
+        if (session.closed) {
+            fs.rm(session.dir, { recursive: true, force: true }).catch(() => {});
+        } else if (pch.stale) {
+            retirePreamble(pch);
+        }
+    });
+    return null;
+}
+
+function retirePreamble(pch) {
+    pch.stale = true;
+    if (!pch.uses) {
+        Promise.all(pch.files.map(cleanupTempFile));
+    }
+}
+
+async function checkSessionSyntax(session) {
+    const compiler = PREAMBLE_COMPILERS[session.language];
+    const full = async () => {
+        const result = await SYNTAX_CHECKERS[session.language](session.code);
+        if (result.standard && result.standard !== 'Unknown') {
+            session.standard = result.standard;
+        }
+        return result;
+    };
+    const split = compiler && splitPreamble(session.code);
+    const standard = split && compiler.standard(session);
+    const pch = standard && sessionPreamble(session, split.preamble, standard);
+    if (!pch) {
+        const result = await full();
+        const detected = split && !session.closed && compiler.standard(session);
+        if (detected) {
+            sessionPreamble(session, split.preamble, detected); // ready for the next edit
+        }
+        return result;
+    }
+
+    pch.uses++;
+    try {
+        const args = [
+            ...compiler.args(standard.std), '-fsyntax-only',
+            '-include', compilerPool.pathFor(pch.header), '-Winvalid-pch', '-x', compiler.source, '-'
+        ];
+        const { success, diagnostics } = await runCompiler(args, { input: `#line ${split.lines + 1}\n${split.body}`, pin: session.pin });
+        if (success) {
+            return compiler.valid(standard);
+        }
+        if (!diagnostics.diagnostics.length || diagnostics.truncated) {
+            return full(); // not a verdict on the code, or one that may hide a preamble error
+        }
+        const preludeLines = compiler.prelude.split('\n').length - 1;
+        const header = compilerPool.pathFor(pch.header);
+        diagnostics.diagnostics.forEach(diagnostic => relocateDiagnostic(diagnostic, header, SOURCE_LABEL, preludeLines));
+        return compiler.invalid(diagnostics, standard) || full();
+    } finally {
+        pch.uses--;
+        if (pch.stale) {
+            retirePreamble(pch);
+        }
+    }
+}
+
+// Check a session's current text: from the result cache if possible,
+// otherwise admitted through the scheduler like any other check
+async function checkSession(session) {
+    const cacheKey = await syntaxCacheKey(session.language, session.code);
+    const cached = await resultCache.get(cacheKey);
+    if (cached) {
+        return { syntaxResult: cached, cache: 'HIT' };
+    }
+    const rejected = precheckSyntax(session.language, session.code);
+    if (rejected) {
+        return { syntaxResult: rejected, cache: 'MISS' };
+    }
+    const release = await scheduler.admit(session.language, session.apiKey);
+    try {
+        const syntaxResult = await checkSessionSyntax(session);
+        if (isCacheableResult(session.language, syntaxResult)) {
+            await resultCache.set(cacheKey, syntaxResult);
+        }
+        return { syntaxResult, cache: 'MISS' };
+    } finally {
+        release();
+    }
+}
+
+// Session requests are answered as { status, headers, body }, so that in
+// cluster mode one can be handed to the worker that owns the session and
+// the answer relayed back
+async function sessionCheckResponse(session, language) {
+    const version = session.version;
+    try {
+        const { syntaxResult, cache } = await requestContext.run({ language: session.language }, () => checkSession(session));
         return {
-            valid: false,
-            error: error.message
+            status: 200,
+            headers: { 'X-Cache': cache },
+            body: { sessionId: session.id, version, ...syntaxResponse(syntaxResult, language, session.language) }
         };
+    } catch (error) {
+        if (error instanceof AdmissionError) {
+            return {
+                status: 429,
+                headers: { 'Retry-After': String(error.retryAfter) },
+                body: { error: error.message, retryAfter: error.retryAfter }
+            };
+        }
+        console.error('Error checking session:', error);
+        return { status: 500, body: { error: 'Internal server error', details: error.message } };
+    }
+}
+
+// In cluster mode a session id starts with the id of the worker that
+// opened it, which keeps its text and its preamble PCH
+const SESSION_OWNER = IS_WORKER ? `${cluster.worker.id}-` : '';
+
+function sessionOwner(id) {
+    const match = /^(\d+)-/.exec(id);
+    return match ? Number(match[1]) : null;
+}
+
+// Open a session: { language, code } in, its id and first check out
+async function openSession({ body, apiKey }) {
+    const { code = '', language } = body;
+    if (typeof code !== 'string' || !language) {
+        return { status: 400, body: { error: 'A language and a code string are required' } };
+    }
+    const normalizedLang = normalizeLanguage(language);
+    if (!normalizedLang) {
+        return { status: 400, body: { error: 'Unsupported language' } };
+    }
+
+    const id = `${SESSION_OWNER}${crypto.randomUUID()}`;
+    const session = await sessionStore.create({
+        id,
+        language: normalizedLang,
+        apiKey,
+        code,
+        version: 0,
+        standard: null,
+        dir: path.join(tempDir, 'sessions', id),
+        pin: { worker: null },
+        preamble: null,
+        preambleBuilds: 0
+    });
+    return sessionCheckResponse(session, language);
+}
+
+// Change a session's text, with { edits: [{ start, end, text }] } or a
+// whole new { code }, and check the result. With `version`, the change is
+// only applied if it was made against that version (409 otherwise).
+async function editSession(session, body) {
+    const { edits, code, version } = body;
+    if (version !== undefined && version !== session.version) {
+        return { status: 409, body: { error: 'Session has changed', version: session.version } };
+    }
+
+    let next;
+    if (typeof code === 'string') {
+        next = code;
+    } else if (Array.isArray(edits)) {
+        next = applyEdits(session.code, edits);
+        if (next === null) {
+            return { status: 400, body: { error: 'Edit out of range', length: session.code.length } };
+        }
+    } else {
+        return { status: 400, body: { error: 'Either edits or code is required' } };
+    }
+    if (next.length > MAX_CODE_SIZE) {
+        return { status: 413, body: { error: 'Code size exceeds maximum limit' } };
+    }
+
+    if (next !== session.code) {
+        session.code = next;
+        session.version++;
+    }
+    return sessionCheckResponse(session, body.language || session.language);
+}
+
+// Handle a session request in the process that owns the session. Sessions
+// belong to the API key that opened them.
+async function handleSessionRequest({ method, id, body, apiKey }) {
+    if (method === 'POST') {
+        return openSession({ body, apiKey });
+    }
+    const session = await sessionStore.get(id);
+    if (!session || session.apiKey !== apiKey) {
+        return { status: 404, body: { error: 'Unknown session' } };
+    }
+    if (method === 'DELETE') {
+        await sessionStore.delete(session.id);
+        return { status: 204 };
+    }
+    return editSession(session, body);
+}
+
+async function sessionRoute(req, res) {
+    const request = { method: req.method, id: req.params.id, body: req.body, apiKey: req.apiKey };
+    const owner = request.id === undefined ? null : sessionOwner(request.id);
+    let response;
+    try {
+        response = IS_WORKER && owner !== null && owner !== cluster.worker.id
+            ? await primary.call('session.forward', { owner, request })
+            : await handleSessionRequest(request);
+    } catch (error) {
+        console.error('Error handling session request:', error);
+        response = { status: 500, body: { error: 'Internal server error', details: error.message } };
+    }
+    res.status(response.status).set(response.headers || {});
+    if (response.body === undefined) {
+        res.end();
+    } else {
+        res.json(response.body);
+    }
+}
+
+app.post('/sessions', authenticateRequest, sessionRoute);
+app.patch('/sessions/:id', authenticateRequest, sessionRoute);
+app.delete('/sessions/:id', authenticateRequest, sessionRoute);
+
+// What this process alone knows: its histograms, its Babel threads and its
+// sessions. In cluster mode every HTTP worker has its own (and the primary
+// its container_start timings).
+function localMetrics() {
+    return {
+        stages: stageDuration.snapshot(),
+        requests: requestDuration.snapshot(),
+        javascript: jsWorkerPool && jsWorkerPool.stats(),
+        sessions: sessionStore.stats(),
+        workspace: workspace && workspace.stats()
+    };
+}
+
+// The state behind /health and /metrics: the stats of the shared objects
+// and every process's local metrics, gathered by the primary in cluster mode
+async function collectMetrics() {
+    if (IS_WORKER) {
+        return primary.call('metrics');
+    }
+    const workerMetrics = IS_PRIMARY
+        ? await Promise.all([...workerChannels.values()].map(channel => channel.call('metrics').catch(() => null)))
+        : [];
+    return {
+        scheduler: scheduler.stats(),
+        cache: resultCache.stats(),
+        compiler: compilerPool.stats(),
+        python: pythonWorkerPool.stats(),
+        java: javaService.stats(),
+        processes: [localMetrics(), ...workerMetrics].filter(Boolean)
+    };
+}
+
+// Field-by-field sums of stats objects, skipping nulls
+function sumStats(stats) {
+    const total = {};
+    for (const entry of stats.filter(Boolean)) {
+        for (const [field, value] of Object.entries(entry)) {
+            total[field] = (total[field] || 0) + value;
+        }
     }
+    return total;
 }
 
 // Health check endpoint
-app.get('/health', (req, res) => {
-    res.status(200).json({ status: 'healthy', timestamp: new Date().toISOString() });
+app.get('/health', async (req, res) => {
+    const metrics = await collectMetrics();
+    const sessions = sumStats(metrics.processes.map(part => part.sessions));
+    res.status(200).json({ status: 'healthy', timestamp: new Date().toISOString(), cache: metrics.cache, scheduler: metrics.scheduler, sessions });
+});
+
+// Prometheus scrape endpoint: the stage and request histograms, plus the
+// scheduler's queues, each pool's workers and the result cache as of now.
+// In cluster mode the histograms are the sum over every process.
+app.get('/metrics', async (req, res) => {
+    const metrics = await collectMetrics();
+    const { capacity, inUse, languages } = metrics.scheduler;
+    const lanes = Object.entries(languages);
+    const laneSamples = field => lanes.map(([language, lane]) => [{ language }, lane[field]]);
+    const pools = Object.entries({
+        compiler: metrics.compiler,
+        javascript: sumStats(metrics.processes.map(part => part.javascript)),
+        python: metrics.python,
+        java: metrics.java
+    });
+    const poolSamples = field => pools.map(([pool, stats]) => [{ pool }, stats[field] || 0]);
+    const cache = metrics.cache;
+    const slots = sumStats(metrics.processes.map(part => part.workspace));
+    const merged = (histogram, field) => {
+        const total = histogram.blank();
+        for (const part of metrics.processes) {
+            total.merge(part[field]);
+        }
+        return total;
+    };
+
+    const body = [
+        merged(stageDuration, 'stages').render(),
+        merged(requestDuration, 'requests').render(),
+        renderSamples('syntax_checker_scheduler_queued_jobs', 'Jobs waiting for admission.', 'gauge', laneSamples('queued')),
+        renderSamples('syntax_checker_scheduler_running_jobs', 'Admitted jobs still running.', 'gauge', laneSamples('running')),
+        renderSamples('syntax_checker_scheduler_admitted_total', 'Jobs admitted.', 'counter', laneSamples('admitted')),
+        renderSamples('syntax_checker_scheduler_rejected_total', 'Jobs turned away with 429 because their queue was full.', 'counter', laneSamples('rejected')),
+        renderSamples('syntax_checker_scheduler_capacity_used_ratio', 'Share of SCHEDULER_CAPACITY held by running jobs.', 'gauge', [[{}, capacity ? inUse / capacity : 0]]),
+        renderSamples('syntax_checker_pool_workers', 'Workers in each pool.', 'gauge', poolSamples('workers')),
+        renderSamples('syntax_checker_pool_busy_workers', 'Workers with a job in progress.', 'gauge', poolSamples('busy')),
+        renderSamples('syntax_checker_pool_queued_jobs', 'Jobs waiting for a pool worker.', 'gauge', poolSamples('queued')),
+        renderSamples('syntax_checker_pool_utilization_ratio', 'Busy workers over workers.', 'gauge',
+            pools.map(([pool, stats]) => [{ pool }, stats.workers ? stats.busy / stats.workers : 0])),
+        renderSamples('syntax_checker_cache_lookups_total', 'Result cache lookups by outcome.', 'counter', [
+            [{ result: 'hit' }, cache.hits], [{ result: 'shared_hit' }, cache.sharedHits], [{ result: 'miss' }, cache.misses]
+        ]),
+        renderSamples('syntax_checker_cache_entries', 'Entries in the in-memory result cache.', 'gauge', [[{}, cache.entries]]),
+        renderSamples('syntax_checker_cache_hit_ratio', 'Lookups answered from either cache tier.', 'gauge', [[{}, cache.hitRate]]),
+        renderSamples('syntax_checker_sessions', 'Open editor sessions.', 'gauge',
+            [[{}, sumStats(metrics.processes.map(part => part.sessions)).sessions || 0]]),
+        renderSamples('syntax_checker_workspace_slots', 'Scratch slots by state.', 'gauge', [
+            [{ state: 'free' }, slots.free || 0], [{ state: 'in_use' }, (slots.slots || 0) - (slots.free || 0)]
+        ]),
+        renderSamples('syntax_checker_workspace_waiting_jobs', 'Jobs waiting for a scratch slot.', 'gauge', [[{}, slots.waiting || 0]])
+    ];
+    res.type('text/plain; version=0.0.4').send(body.join('\n') + '\n');
 });
 
+// The calls the primary serves to one HTTP worker, which holds the
+// admissions in `tickets` until it releases them
+function primaryHandlers(tickets) {
+    let nextTicket = 0;
+    return {
+        'compiler.run': async ({ args, options, pin }, { emit, signal }) => {
+            const pinned = pin === undefined ? undefined : { worker: pin && compilerPool.idleWorker(pin) };
+            const { stdout, stderr } = await compilerPool.run(args, {
+                timeout: options.timeout,
+                input: options.input,
+                maxOutput: options.maxOutput,
+                buffer: options.buffer,
+                signal,
+                pin: pinned,
+                onStdout: options.stdout ? text => emit('stdout', text) : undefined,
+                onStderr: options.stderr ? text => emit('stderr', text) : undefined
+            });
+            return { stdout, stderr, pin: pinned && pinned.worker ? pinned.worker.name : null };
+        },
+        'python.check': ({ code }) => pythonWorkerPool.check(code),
+        'java.request': async ({ operation, code, timeout }, { emit }) => {
+            try {
+                return await javaService.request(operation, code, timeout, partial => emit('partial', partial));
+            } catch (error) {
+                error.javaAvailable = javaService.available;
+                throw error;
+            }
+        },
+        'scheduler.admit': async ({ language, apiKey }, { signal }) => {
+            const ticket = nextTicket++;
+            const release = await scheduler.admit(language, apiKey, signal);
+            // Admitted just as the worker went away: nobody will release it
+            if (signal.aborted) {
+                release();
+                throw new Error('HTTP worker exited');
+            }
+            tickets.set(ticket, release);
+            return ticket;
+        },
+        'scheduler.release': ({ ticket }) => {
+            const release = tickets.get(ticket);
+            tickets.delete(ticket);
+            if (release) {
+                release();
+            }
+        },
+        'cache.get': ({ key }) => resultCache.get(key),
+        'cache.set': ({ key, value }) => resultCache.set(key, value),
+        'session.forward': ({ owner, request }) => {
+            const channel = workerChannels.get(owner);
+            return channel ? channel.call('session', request) : { status: 404, body: { error: 'Unknown session' } };
+        },
+        metrics: () => collectMetrics()
+    };
+}
+
+// HTTP workers by cluster worker id, with the channel to each
+const workerChannels = new Map();
+let shuttingDown = false;
+
+function forkWorker() {
+    const worker = cluster.fork();
+    const tickets = new Map();
+    workerChannels.set(worker.id, new RpcChannel(worker, primaryHandlers(tickets)));
+    worker.on('exit', (code, signal) => {
+        workerChannels.get(worker.id).close('HTTP worker exited');
+        workerChannels.delete(worker.id);
+        fs.rm(workspaceRoot(worker.id), { recursive: true, force: true }).catch(console.error);
+        // A dead worker's admissions are given back; closing its channel
+        // has already cancelled the ones still queued
+        for (const release of tickets.values()) {
+            release();
+        }
+        tickets.clear();
+        if (!shuttingDown) {
+            console.error(`HTTP worker ${worker.process.pid} exited (${signal || code}), starting another`);
+            forkWorker();
+        }
+    });
+}
+
 // Start server
-app.listen(PORT, () => {
-    console.log(`Server is running on port ${PORT}`);
-}); 
\ No newline at end of file
+if (IS_PRIMARY) {
+    workspaceReady.finally(() => {
+        for (let i = 0; i < CLUSTER_WORKERS; i++) {
+            forkWorker();
+        }
+        console.log(`Server is running on port ${PORT} with ${CLUSTER_WORKERS} HTTP workers`);
+    });
+} else {
+    app.listen(PORT, () => {
+        if (!IS_WORKER) {
+            console.log(`Server is running on port ${PORT}`);
+        }
+    });
+}
+
+// Remove the compiler workers on shutdown. The primary stops its HTTP
+// workers first; each stops its own Babel threads.
+for (const signal of ['SIGINT', 'SIGTERM']) {
+    process.on(signal, () => {
+        shuttingDown = true;
+        for (const id of workerChannels.keys()) {
+            cluster.workers[id].kill();
+        }
+        const pools = [compilerPool, jsWorkerPool, pythonWorkerPool, javaService].filter(Boolean);
+        Promise.all(pools.map(pool => pool.stop())).finally(() => process.exit(0));
+    });
+}
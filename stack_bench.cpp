@@ -0,0 +1,564 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Stack.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Build: g++ -std=c++17 -O2 -pthread stack_bench.cpp -latomic -o stack_bench
+// Usage: ./stack_bench [--json] [--filter <substring>] [--min-time <seconds>]
+//
+// Reports ns/op, heap allocations/op and (on Linux, where perf events are
+// permitted) last-level cache misses/op for every Stack variant in
+// Stack.hpp. LegacyStack is the original fixed MAX_SIZE=100 array and stays
+// here as the regression baseline.
+
+// ---------------------------------------------------------------------------
+// Allocation counting
+
+static std::atomic<std::uint64_t> allocationCount(0);
+
+// Kept out of line so GCC does not pair the inlined malloc/free with
+// new/delete expressions and warn about a mismatch that is not there.
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+[[gnu::noinline]] void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+// ---------------------------------------------------------------------------
+// Cache miss counter
+
+class CacheMissCounter {
+private:
+    int fd;
+
+public:
+    CacheMissCounter() : fd(-1) {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    bool available() const {
+        return fd >= 0;
+    }
+
+    void start() {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    std::uint64_t stop() {
+        std::uint64_t value = 0;
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value))) {
+                value = 0;
+            }
+        }
+#endif
+        return value;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Harness
+
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchOptions {
+    bool json;
+    std::string filter;
+    double minTime;
+};
+
+struct BenchResult {
+    std::string name;
+    std::uint64_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double cacheMissesPerOp;
+    bool haveCacheMisses;
+};
+
+static std::vector<BenchResult> results;
+static BenchOptions options = { false, "", 0.2 };
+static CacheMissCounter* cacheMisses = nullptr;
+
+// Runs body(iterations) with a growing iteration count until one run takes
+// at least options.minTime, then records that run. ops is the number of
+// stack operations a single iteration performs.
+template <typename Body>
+void benchmark(const std::string& name, std::uint64_t ops, Body body) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+        return;
+    }
+
+    std::uint64_t iterations = 1;
+    for (;;) {
+        const std::uint64_t allocsBefore = allocationCount.load(std::memory_order_relaxed);
+        cacheMisses->start();
+        const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        body(iterations);
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        const std::uint64_t misses = cacheMisses->stop();
+        const std::uint64_t allocs = allocationCount.load(std::memory_order_relaxed) - allocsBefore;
+
+        const double seconds = std::chrono::duration<double>(end - begin).count();
+        if (seconds >= options.minTime || iterations >= (1ULL << 40)) {
+            const double totalOps = static_cast<double>(iterations * ops);
+            BenchResult result;
+            result.name = name;
+            result.iterations = iterations;
+            result.nsPerOp = seconds * 1e9 / totalOps;
+            result.allocsPerOp = allocs / totalOps;
+            result.cacheMissesPerOp = misses / totalOps;
+            result.haveCacheMisses = cacheMisses->available();
+            results.push_back(result);
+            if (!options.json) {
+                std::printf("%-48s %12llu %10.2f %10.4f ", name.c_str(),
+                            static_cast<unsigned long long>(iterations), result.nsPerOp, result.allocsPerOp);
+                if (result.haveCacheMisses) {
+                    std::printf("%12.4f\n", result.cacheMissesPerOp);
+                } else {
+                    std::printf("%12s\n", "n/a");
+                }
+                std::fflush(stdout);
+            }
+            return;
+        }
+        const double scale = seconds > 0 ? options.minTime / seconds * 1.2 : 10.0;
+        iterations = static_cast<std::uint64_t>(iterations * (scale > 10.0 ? 10.0 : (scale < 2.0 ? 2.0 : scale)));
+    }
+}
+
+static void printJson() {
+    std::printf("[\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        std::printf("  {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.4f, "
+                    "\"allocs_per_op\": %.6f, \"cache_misses_per_op\": ",
+                    r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.nsPerOp, r.allocsPerOp);
+        if (r.haveCacheMisses) {
+            std::printf("%.6f}", r.cacheMissesPerOp);
+        } else {
+            std::printf("null}");
+        }
+        std::printf(i + 1 < results.size() ? ",\n" : "\n");
+    }
+    std::printf("]\n");
+}
+
+// ---------------------------------------------------------------------------
+// Baseline: the original Stack.hpp before it became growable
+
+template <typename T>
+class LegacyStack {
+private:
+    static const int MAX_SIZE = 100;
+    T arr[MAX_SIZE];
+    int top;
+
+public:
+    LegacyStack() : top(-1) {}
+
+    void push(const T& value) {
+        if (top >= MAX_SIZE - 1) {
+            throw std::overflow_error("Stack is full");
+        }
+        arr[++top] = value;
+    }
+
+    T pop() {
+        if (isEmpty()) {
+            throw std::underflow_error("Stack is empty");
+        }
+        return arr[top--];
+    }
+
+    bool isEmpty() const {
+        return top == -1;
+    }
+};
+
+// Adapts ConcurrentStack to the push/pop/isEmpty surface the workloads use.
+template <typename T>
+class ConcurrentStackAdapter {
+private:
+    ConcurrentStack<T> stack;
+
+public:
+    void push(const T& value) {
+        stack.push(value);
+    }
+
+    T pop() {
+        std::optional<T> value = stack.tryPop();
+        if (!value) {
+            throw std::underflow_error("Stack is empty");
+        }
+        return std::move(*value);
+    }
+
+    bool isEmpty() const {
+        return stack.isEmpty();
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Sample values
+
+template <typename T> T sampleValue(int i);
+
+template <> int sampleValue<int>(int i) {
+    return i;
+}
+
+template <> double sampleValue<double>(int i) {
+    return i * 1.5;
+}
+
+template <> std::string sampleValue<std::string>(int i) {
+    // Longer than the small-string buffer so copies really hit the heap
+    return std::string(32, static_cast<char>('a' + i % 26));
+}
+
+template <> std::vector<int> sampleValue<std::vector<int> >(int i) {
+    return std::vector<int>(8, i);
+}
+
+// ---------------------------------------------------------------------------
+// Workloads
+
+// Depth of the push/pop workloads; small enough for LegacyStack and
+// FixedStack<T, 128>, and typical of per-line bracket stacks.
+static const int DEPTH = 64;
+
+template <typename S>
+void benchConstruction(const std::string& name) {
+    benchmark(name + "/construct", 1, [](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            S stack;
+            doNotOptimize(stack);
+        }
+    });
+}
+
+template <typename S, typename T>
+void benchPushPop(const std::string& name) {
+    std::vector<T> values;
+    for (int i = 0; i < DEPTH; ++i) {
+        values.push_back(sampleValue<T>(i));
+    }
+    benchmark(name + "/push_pop", 2 * DEPTH, [&values](std::uint64_t iterations) {
+        S stack;
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            for (int j = 0; j < DEPTH; ++j) {
+                stack.push(values[j]);
+            }
+            while (!stack.isEmpty()) {
+                T value = stack.pop();
+                doNotOptimize(value);
+            }
+        }
+    });
+}
+
+// Bracket-matching shaped traffic: short bursts of pushes and pops on a
+// fresh stack per "line", never deeper than 16.
+template <typename S, typename T>
+void benchMixed(const std::string& name) {
+    static const char pattern[] = "(((()())(()))((())()))[[]]{{}{()}}";
+    const int length = sizeof(pattern) - 1;
+    const T value = sampleValue<T>(7);
+    benchmark(name + "/mixed", length, [&](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            S stack;
+            for (int j = 0; j < length; ++j) {
+                const char c = pattern[j];
+                if (c == '(' || c == '[' || c == '{') {
+                    stack.push(value);
+                } else {
+                    T popped = stack.pop();
+                    doNotOptimize(popped);
+                }
+            }
+        }
+    });
+}
+
+template <typename S, typename T>
+void benchAll(const std::string& name) {
+    benchConstruction<S>(name);
+    benchPushPop<S, T>(name);
+    benchMixed<S, T>(name);
+}
+
+template <typename T>
+void benchBulk(const std::string& name) {
+    std::vector<T> values;
+    for (int i = 0; i < DEPTH; ++i) {
+        values.push_back(sampleValue<T>(i));
+    }
+    std::vector<T> out(DEPTH);
+    benchmark(name + "/push_range_pop_n", 2 * DEPTH, [&](std::uint64_t iterations) {
+        Stack<T> stack;
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            stack.pushRange(values.data(), values.data() + DEPTH);
+            stack.popN(DEPTH, out.data());
+            doNotOptimize(out[0]);
+        }
+    });
+}
+
+// Per-request scratch traffic: one "request" builds SCRATCH_STACKS
+// short-lived stacks in turn (one per scope a parser visits), pushes each
+// to a depth between 4 and 36 and drops it. makeStack() builds a stack and
+// endRequest() runs once all of them are gone, which is where an arena is
+// rewound.
+static const int SCRATCH_STACKS = 32;
+
+template <typename T, typename Make, typename EndRequest>
+void benchScratch(const std::string& name, Make makeStack, EndRequest endRequest) {
+    std::uint64_t ops = 0;
+    for (int s = 0; s < SCRATCH_STACKS; ++s) {
+        ops += 2 * (4 + (s * 7) % 33);
+    }
+    const T value = sampleValue<T>(5);
+    benchmark(name + "/scratch", ops, [&](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            for (int s = 0; s < SCRATCH_STACKS; ++s) {
+                auto stack = makeStack();
+                const int depth = 4 + (s * 7) % 33;
+                for (int j = 0; j < depth; ++j) {
+                    stack.push(value);
+                }
+                while (!stack.isEmpty()) {
+                    T popped = stack.pop();
+                    doNotOptimize(popped);
+                }
+            }
+            endRequest();
+        }
+    });
+}
+
+// The same scratch traffic on std::allocator and on a MonotonicArena, with
+// and without an inline buffer
+template <typename T>
+void benchScratchVariants(const std::string& typeName) {
+    MonotonicArena arena;
+    const auto noop = []() {};
+    const auto rewind = [&arena]() { arena.reset(); };
+    benchScratch<T>("Stack<" + typeName + ">", []() { return Stack<T>(); }, noop);
+    benchScratch<T>("ArenaStack<" + typeName + ">", [&arena]() { return ArenaStack<T>(arena); }, rewind);
+    benchScratch<T>("SmallStack<" + typeName + ", 16>", []() { return SmallStack<T, 16>(); }, noop);
+    benchScratch<T>("ArenaStack<" + typeName + ", 16>", [&arena]() { return ArenaStack<T, 16>(arena); }, rewind);
+}
+
+// A batch of many tiny stacks, one per submission: BATCH_STACKS stacks are
+// built, each is pushed to BATCH_DEPTH and drained, and the batch is
+// dropped. Separate Stack objects against one MultiStack, driven stack by
+// stack and with the bulk operations.
+static const int BATCH_STACKS = 512;
+static const int BATCH_DEPTH = 8;
+
+static void benchBatch() {
+    const std::uint64_t ops = 2 * BATCH_STACKS * BATCH_DEPTH;
+    benchmark("Stack<uint32_t> x512/batch", ops, [](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            std::vector<Stack<std::uint32_t> > stacks(BATCH_STACKS);
+            for (int k = 0; k < BATCH_STACKS; ++k) {
+                for (int j = 0; j < BATCH_DEPTH; ++j) {
+                    stacks[k].push(static_cast<std::uint32_t>(j));
+                }
+                while (!stacks[k].isEmpty()) {
+                    std::uint32_t popped = stacks[k].pop();
+                    doNotOptimize(popped);
+                }
+            }
+        }
+    });
+    benchmark("MultiStack<uint32_t> x512/batch", ops, [](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            MultiStack<std::uint32_t> stacks(BATCH_STACKS, BATCH_DEPTH);
+            for (int k = 0; k < BATCH_STACKS; ++k) {
+                for (int j = 0; j < BATCH_DEPTH; ++j) {
+                    stacks.push(k, static_cast<std::uint32_t>(j));
+                }
+                while (!stacks.isEmpty(k)) {
+                    std::uint32_t popped = stacks.pop(k);
+                    doNotOptimize(popped);
+                }
+            }
+        }
+    });
+    std::vector<std::uint32_t> values(BATCH_STACKS, 7);
+    std::vector<std::uint32_t> out(BATCH_STACKS);
+    benchmark("MultiStack<uint32_t> x512/batch_bulk", ops, [&](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            MultiStack<std::uint32_t> stacks(BATCH_STACKS, BATCH_DEPTH);
+            for (int j = 0; j < BATCH_DEPTH; ++j) {
+                stacks.pushAll(values.data());
+            }
+            for (int j = 0; j < BATCH_DEPTH; ++j) {
+                stacks.popAll(out.data());
+                doNotOptimize(out[0]);
+            }
+        }
+    });
+}
+
+template <typename T>
+void benchContended(const std::string& name) {
+    const unsigned threads = std::thread::hardware_concurrency() < 2 ? 2 : std::thread::hardware_concurrency();
+    const T value = sampleValue<T>(3);
+    benchmark(name + "/contended_x" + std::to_string(threads), threads * 2, [&](std::uint64_t iterations) {
+        ConcurrentStack<T> stack;
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&]() {
+                for (std::uint64_t i = 0; i < iterations; ++i) {
+                    stack.push(value);
+                    std::optional<T> popped = stack.tryPop();
+                    doNotOptimize(popped);
+                }
+            });
+        }
+        for (size_t t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+    });
+}
+
+template <typename T>
+void benchType(const std::string& typeName) {
+    benchAll<LegacyStack<T>, T>("LegacyStack<" + typeName + ">");
+    benchAll<Stack<T>, T>("Stack<" + typeName + ">");
+    benchAll<SmallStack<T, 16>, T>("SmallStack<" + typeName + ", 16>");
+    benchAll<ConcurrentStackAdapter<T>, T>("ConcurrentStack<" + typeName + ">");
+    benchBulk<T>("Stack<" + typeName + ">");
+    benchScratchVariants<T>(typeName);
+    benchContended<T>("ConcurrentStack<" + typeName + ">");
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            options.minTime = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--json] [--filter <substring>] [--min-time <seconds>]\n";
+            return 1;
+        }
+    }
+
+    CacheMissCounter counter;
+    cacheMisses = &counter;
+
+    if (!options.json) {
+        std::printf("%-48s %12s %10s %10s %12s\n", "benchmark", "iterations", "ns/op", "allocs/op", "misses/op");
+    }
+
+    try {
+        benchType<int>("int");
+        benchType<double>("double");
+        benchType<std::string>("std::string");
+        benchType<std::vector<int> >("std::vector<int>");
+
+        // FixedStack needs default-constructible, cheaply copyable elements
+        benchAll<FixedStack<int, 128>, int>("FixedStack<int, 128>");
+        benchAll<FixedStack<double, 128>, double>("FixedStack<double, 128>");
+        benchBatch();
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (options.json) {
+        printJson();
+    }
+    return 0;
+}
@@ -1,46 +1,6 @@
 #include <iostream>
-#include <stdexcept>
 #include <string>
-
-template<typename T>
-class Stack {
-private:
-    static const int MAX_SIZE = 100;
-    T arr[MAX_SIZE];
-    int top;
-
-public:
-    Stack() : top(-1) {}
-
-    void push(const T& value) {
-        if (top >= MAX_SIZE - 1) {
-            throw std::overflow_error("Stack is full");
-        }
-        arr[++top] = value;
-    }
-
-    T pop() {
-        if (isEmpty()) {
-            throw std::underflow_error("Stack is empty");
-        }
-        return arr[top--];
-    }
-
-    T peek() const {
-        if (isEmpty()) {
-            throw std::underflow_error("Stack is empty");
-        }
-        return arr[top];
-    }
-
-    bool isEmpty() const {
-        return top == -1;
-    }
-
-    int size() const {
-        return top + 1;
-    }
-};
+#include "Stack.hpp"
 
 int main() {
     try {
@@ -67,7 +27,7 @@ int main() {
 
         // Test 2: Double Stack with Overflow Test
         std::cout << "\nTest 2: Double Stack with Overflow Test" << std::endl;
-        Stack<double> doubleStack;
+        FixedStack<double, 100> doubleStack;
         
         // Fill the stack
         for (int i = 0; i < 100; i++) {
@@ -1,7 +1,10 @@
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 #include <vector>
-#include "Stack.h"
+#include "Stack.hpp"
 
 // Test Case 1: Basic Stack Operations
 void testBasicOperations() {
@@ -84,14 +87,11 @@ void testErrorHandling() {
         std::cout << "Caught underflow error: " << e.what() << "\n";
     }
     
-    try {
-        std::cout << "Testing overflow:\n";
-        for (int i = 0; i < 101; i++) { // MAX_SIZE is 100
-            stack.push(i);
-        }
-    } catch (const std::overflow_error& e) {
-        std::cout << "Caught overflow error: " << e.what() << "\n";
+    std::cout << "Testing push past the old 100-element limit:\n";
+    for (int i = 0; i < 101; i++) {
+        stack.push(i);
     }
+    std::cout << "Size after 101 pushes: " << stack.size() << "\n";
 }
 
 // Test Case 5: Complex Data Types
@@ -121,6 +121,239 @@ void testComplexDataTypes() {
     std::cout << "\n";
 }
 
+// Test Case 6: Growth and Capacity
+void testGrowthAndCapacity() {
+    std::cout << "\n=== Test Case 6: Growth and Capacity ===\n";
+    Stack<int> stack;
+    std::cout << "Capacity of new stack: " << stack.capacity() << "\n";
+
+    stack.reserve(1000);
+    std::cout << "Capacity after reserve(1000): " << stack.capacity() << "\n";
+
+    for (int i = 0; i < 1000000; i++) {
+        stack.push(i);
+    }
+    std::cout << "Size after 1000000 pushes: " << stack.size()
+              << ", capacity: " << stack.capacity() << "\n";
+
+    while (stack.size() > 10) {
+        stack.pop();
+    }
+    stack.shrinkToFit();
+    std::cout << "Capacity after popping to 10 and shrinkToFit(): " << stack.capacity() << "\n";
+    std::cout << "Top after shrink: " << stack.pop() << "\n";
+
+    // Copies are independent
+    Stack<std::string> original;
+    original.push("parse");
+    original.push("token");
+    Stack<std::string> copy(original);
+    original.pop();
+    std::cout << "Copy still holds: " << copy.pop() << "\n";
+}
+
+// Test Case 7: Move Semantics
+struct CopyCounter {
+    static int copies;
+    int value;
+
+    explicit CopyCounter(int v) : value(v) {}
+    CopyCounter(const CopyCounter& other) : value(other.value) { ++copies; }
+    CopyCounter(CopyCounter&& other) noexcept : value(other.value) {}
+    CopyCounter& operator=(const CopyCounter& other) { value = other.value; ++copies; return *this; }
+    CopyCounter& operator=(CopyCounter&& other) noexcept { value = other.value; return *this; }
+};
+int CopyCounter::copies = 0;
+
+void testMoveSemantics() {
+    std::cout << "\n=== Test Case 7: Move Semantics ===\n";
+    Stack<CopyCounter> stack;
+
+    for (int i = 0; i < 100; i++) {
+        stack.emplace(i);
+    }
+    stack.push(CopyCounter(100));
+    std::cout << "Copies after 100 emplaces, 1 rvalue push and regrowth: " << CopyCounter::copies << "\n";
+
+    CopyCounter out(-1);
+    while (stack.tryPop(out)) {
+    }
+    std::cout << "Last value from tryPop: " << out.value
+              << ", copies after draining: " << CopyCounter::copies << "\n";
+    std::cout << "tryPop on empty stack: " << (stack.tryPop(out) ? "true" : "false") << "\n";
+
+    Stack<std::string> strings;
+    std::string token(64, 'x');
+    strings.push(std::move(token));
+    strings.emplace(3, 'y');
+    Stack<std::string> moved(std::move(strings));
+    std::cout << "Moved-from stack is empty? " << (strings.isEmpty() ? "Yes" : "No") << "\n";
+    std::cout << "Popped from moved-to stack: " << moved.pop() << "\n";
+}
+
+// Test Case 8: Uninitialized Storage
+struct AstNode {
+    static int live;
+    std::string kind;
+    int line;
+
+    AstNode(const std::string& k, int l) : kind(k), line(l) { ++live; }
+    AstNode(const AstNode& other) : kind(other.kind), line(other.line) { ++live; }
+    AstNode(AstNode&& other) noexcept : kind(std::move(other.kind)), line(other.line) { ++live; }
+    AstNode& operator=(const AstNode& other) { kind = other.kind; line = other.line; return *this; }
+    AstNode& operator=(AstNode&& other) noexcept { kind = std::move(other.kind); line = other.line; return *this; }
+    ~AstNode() { --live; }
+};
+int AstNode::live = 0;
+
+void testUninitializedStorage() {
+    std::cout << "\n=== Test Case 8: Uninitialized Storage ===\n";
+    {
+        Stack<AstNode> empty;
+        std::cout << "Live nodes in an empty stack: " << AstNode::live << "\n";
+    }
+
+    Stack<AstNode> nodes;
+    nodes.emplace("FunctionDecl", 1);
+    nodes.emplace("CompoundStmt", 2);
+    nodes.emplace("ReturnStmt", 3);
+    std::cout << "Live nodes after 3 emplaces: " << AstNode::live << "\n";
+
+    AstNode top = nodes.pop();
+    std::cout << "Popped " << top.kind << " at line " << top.line
+              << ", live nodes: " << AstNode::live << "\n";
+
+    nodes.clear();
+    std::cout << "Live nodes after clear(): " << AstNode::live
+              << ", capacity kept: " << nodes.capacity() << "\n";
+}
+
+// Test Case 9: Peek and Bulk Operations
+void testBulkOperations() {
+    std::cout << "\n=== Test Case 9: Peek and Bulk Operations ===\n";
+    Stack<int> tokens;
+    int buffer[6] = { 1, 2, 3, 4, 5, 6 };
+
+    tokens.pushRange(buffer, buffer + 6);
+    std::cout << "Size after pushRange of 6: " << tokens.size()
+              << ", top: " << tokens.peek() << "\n";
+
+    int out[4] = { 0, 0, 0, 0 };
+    tokens.popN(4, out);
+    std::cout << "popN(4) returned: ";
+    for (int i = 0; i < 4; i++) {
+        std::cout << out[i] << " ";
+    }
+    std::cout << "\nRemaining size: " << tokens.size() << ", top: " << tokens.peek() << "\n";
+
+    try {
+        tokens.popN(3, out);
+    } catch (const std::underflow_error& e) {
+        std::cout << "Caught underflow error: " << e.what()
+                  << ", size unchanged: " << tokens.size() << "\n";
+    }
+
+    std::vector<std::string> words;
+    words.push_back("int");
+    words.push_back("main");
+    words.push_back("(");
+    Stack<std::string> wordStack;
+    wordStack.pushRange(words.begin(), words.end());
+    std::vector<std::string> popped;
+    wordStack.popN(2, std::back_inserter(popped));
+    std::cout << "popN(2) on strings: " << popped[0] << " " << popped[1]
+              << ", left on top: " << wordStack.peek() << "\n";
+}
+
+// Test Case 10: Arena-Backed Stacks
+void testArenaStacks() {
+    std::cout << "\n=== Test Case 10: Arena-Backed Stacks ===\n";
+    MonotonicArena arena;
+    {
+        ArenaStack<int> brackets(arena);
+        ArenaStack<std::string> tokens(arena);
+        brackets.push(0);
+        std::cout << "Buffer cache-line aligned? "
+                  << (reinterpret_cast<std::uintptr_t>(&brackets.peek()) % MonotonicArena::cacheLineSize == 0 ? "Yes" : "No")
+                  << "\n";
+        for (int i = 1; i < 100; i++) {
+            brackets.push(i);
+        }
+        tokens.push(std::string(40, 't'));
+        std::cout << "Top after 100 pushes: " << brackets.peek()
+                  << ", string top: " << tokens.peek().size() << " chars\n";
+
+        ArenaStack<int> moved(std::move(brackets));
+        std::cout << "Moved stack size: " << moved.size()
+                  << ", shares the arena? " << (moved.getAllocator() == ArenaAllocator<int>(arena) ? "Yes" : "No") << "\n";
+    }
+    const std::size_t reserved = arena.bytesReserved();
+    std::cout << "Arena in use after the request: " << (arena.bytesUsed() > 0 ? "Yes" : "No") << "\n";
+
+    arena.reset();
+    std::cout << "In use after reset(): " << arena.bytesUsed() << " bytes\n";
+    {
+        ArenaStack<int, 4> again(arena);
+        for (int i = 0; i < 100; i++) {
+            again.push(i);
+        }
+        std::cout << "Second request reused the blocks? "
+                  << (arena.bytesReserved() == reserved ? "Yes" : "No") << "\n";
+    }
+
+    arena.release();
+    std::cout << "Reserved after release(): " << arena.bytesReserved() << " bytes\n";
+}
+
+// Test Case 11: Multi-Stack
+void testMultiStack() {
+    std::cout << "\n=== Test Case 11: Multi-Stack ===\n";
+    MultiStack<int> lines(4, 3);
+    lines.push(0, 10);
+    lines.push(0, 11);
+    lines.push(2, 30);
+    std::cout << "Sizes: " << lines.size(0) << " " << lines.size(1) << " " << lines.size(2) << " " << lines.size(3)
+              << ", top of stack 0: " << lines.peek(0) << "\n";
+
+    int values[4] = { 1, 2, 3, 4 };
+    std::uint8_t mask[4] = { 0, 1, 1, 1 };
+    lines.pushAll(values, mask);
+    std::cout << "After masked pushAll, tops: " << lines.peek(0) << " " << lines.peek(1) << " "
+              << lines.peek(2) << " " << lines.peek(3) << "\n";
+
+    lines.push(0, 12);
+    try {
+        lines.pushAll(values);
+    } catch (const std::overflow_error& e) {
+        std::cout << "pushAll onto a full stack: " << e.what()
+                  << ", stack 1 size unchanged: " << lines.size(1) << "\n";
+    }
+
+    int out[4] = { 0, 0, 0, 0 };
+    std::uint8_t nonEmpty[4] = { 1, 1, 1, 1 };
+    lines.popAll(out, nonEmpty);
+    std::cout << "popAll: " << out[0] << " " << out[1] << " " << out[2] << " " << out[3] << "\n";
+    try {
+        lines.popAll(out);
+    } catch (const std::underflow_error& e) {
+        std::cout << "popAll from an empty stack: " << e.what() << "\n";
+    }
+
+    MultiStack<int>::StackView second = lines[2];
+    second.push(31);
+    std::cout << "Through a view: size " << second.size() << ", pop " << second.pop()
+              << ", tryPush onto stack 0: " << (lines[0].tryPush(13) ? "true" : "false") << "\n";
+
+    lines.clearAll();
+    std::cout << "Empty after clearAll()? " << (lines.isEmpty(0) && lines.isEmpty(2) ? "Yes" : "No") << "\n";
+
+    MonotonicArena arena;
+    MultiStack<std::uint32_t, ArenaAllocator<std::uint32_t> > brackets(100, 15, arena);
+    std::cout << "Arena-backed stacks cache-line aligned? "
+              << (reinterpret_cast<std::uintptr_t>(brackets.elements(1)) % MonotonicArena::cacheLineSize == 0 ? "Yes" : "No")
+              << "\n";
+}
+
 int main() {
     try {
         testBasicOperations();
@@ -128,6 +361,12 @@ int main() {
         testEdgeCases();
         testErrorHandling();
         testComplexDataTypes();
+        testGrowthAndCapacity();
+        testMoveSemantics();
+        testUninitializedStorage();
+        testBulkOperations();
+        testArenaStacks();
+        testMultiStack();
         
         std::cout << "\nAll tests completed successfully!\n";
     } catch (const std::exception& e) {
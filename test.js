@@ -72,6 +72,21 @@ const tests = [
         name: 'C - Invalid',
         language: 'c',
         code: '#include <stdio.h>\nint main() {\n    printf("Hello World!\\n")\n    return 0;\n}' // Missing semicolon
+    },
+    {
+        name: 'C++ - Unbalanced (rejected by the native pre-checker)',
+        language: 'cpp',
+        code: '#include <iostream>\nint main() {\n    std::cout << (1 + 2;\n    return 0;\n}' // Missing closing parenthesis
+    },
+    {
+        name: 'C - Invalid trigraph brace (left to the compiler by the pre-checker)',
+        language: 'c',
+        code: 'int main() ??< return 0; }' // C is checked as gnu17, which ignores trigraphs; only the compiler can tell
+    },
+    {
+        name: 'C - Brace in a macro argument (left to the compiler by the pre-checker)',
+        language: 'c',
+        code: '#define ID(x) x\nint main(void) ID({) return 0; }' // Arguments of a function-like macro need not balance
     }
 ];
 
@@ -83,5 +98,10 @@ async function runTests() {
     }
 }
 
+// The cases double as the seed corpus for loadtest.js
+module.exports = { tests, testSyntax };
+
 // Run tests
-runTests().catch(console.error);
+if (require.main === module) {
+    runTests().catch(console.error);
+}